@@ -0,0 +1,125 @@
+// Flat node pool holding the AST of one compilation
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+
+static void* ast_realloc(void *p, size_t size) {
+    void *grown = realloc(p, size);
+    if (!grown) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    return grown;
+}
+
+void init_ast(AST *t) {
+    memset(t, 0, sizeof(*t));
+}
+
+// forget all nodes but keep the arrays for the next compilation
+void ast_reset(AST *t) {
+    size_t used = ast_bytes_used(t);
+    if (used > t->bytes_peak) {
+        t->bytes_peak = used;
+    }
+    t->count = 0;
+    t->list_count = 0;
+}
+
+void free_ast(AST *t) {
+    free(t->kind);
+    free(t->op);
+    free(t->a);
+    free(t->b);
+    free(t->lists);
+    init_ast(t);
+}
+
+// append a node; op is only meaningful for AST_BINARY_OP and set by the caller
+NodeId ast_add_node(AST *t, ASTType kind, int32_t a, int32_t b) {
+    if (t->count == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 4096;
+        t->grows++;
+        t->kind = (unsigned char*)ast_realloc(t->kind, t->cap);
+        t->op = (unsigned char*)ast_realloc(t->op, t->cap);
+        t->a = (int32_t*)ast_realloc(t->a, sizeof(int32_t) * t->cap);
+        t->b = (int32_t*)ast_realloc(t->b, sizeof(int32_t) * t->cap);
+    }
+    NodeId n = t->count++;
+    t->kind[n] = (unsigned char)kind;
+    t->op[n] = 0;
+    t->a[n] = a;
+    t->b[n] = b;
+    return n;
+}
+
+// copy a block's statements into lists; returns where they start
+int ast_add_list(AST *t, const NodeId *items, int count) {
+    if (t->list_count + count > t->list_cap) {
+        int cap = t->list_cap ? t->list_cap : 1024;
+        while (cap < t->list_count + count) {
+            cap *= 2;
+        }
+        t->lists = (NodeId*)ast_realloc(t->lists, sizeof(NodeId) * cap);
+        t->list_cap = cap;
+        t->grows++;
+    }
+    int start = t->list_count;
+    if (count > 0) {
+        memcpy(t->lists + start, items, sizeof(NodeId) * count);
+    }
+    t->list_count += count;
+    return start;
+}
+
+// first index of the subtree rooted at n (which is its last); post-order
+// puts it at the end of the chain of first children
+NodeId ast_subtree_start(const AST *t, NodeId n) {
+    for (;;) {
+        switch (t->kind[n]) {
+            case AST_ASSIGNMENT:
+                n = AST_EXPR(t, n);
+                break;
+            case AST_BINARY_OP:
+                n = AST_LEFT(t, n);
+                break;
+            case AST_CONDITIONAL:
+                n = AST_COND(t, n);
+                break;
+            case AST_PROGRAM:
+                if (AST_COUNT(t, n) == 0) {
+                    return n;
+                }
+                n = AST_STMTS(t, n)[0];
+                break;
+            default:
+                return n;
+        }
+    }
+}
+
+// node and statement list bytes in use
+size_t ast_bytes_used(const AST *t) {
+    return (size_t)t->count * AST_NODE_BYTES + (size_t)t->list_count * sizeof(NodeId);
+}
+
+size_t ast_peak_bytes(const AST *t) {
+    size_t used = ast_bytes_used(t);
+    return used > t->bytes_peak ? used : t->bytes_peak;
+}
+
+void ast_stack_push(ASTStack *s, NodeId n) {
+    if (s->top == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 256;
+        s->items = (NodeId*)ast_realloc(s->items, sizeof(NodeId) * s->cap);
+    }
+    s->items[s->top++] = n;
+}
+
+void free_ast_stack(ASTStack *s) {
+    free(s->items);
+    s->items = NULL;
+    s->top = 0;
+    s->cap = 0;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef AST_H
+#define AST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// AST Node Types
+typedef enum {
+    AST_DECLARATION,
+    AST_ASSIGNMENT,
+    AST_BINARY_OP,
+    AST_NUMBER,
+    AST_IDENTIFIER,
+    AST_CONDITIONAL,
+    AST_PROGRAM
+} ASTType;
+
+// Binary operators
+typedef enum {
+    OP_ADD,
+    OP_SUB,
+    OP_EQUAL
+} BinaryOperator;
+
+// index of a node in its pool
+typedef int32_t NodeId;
+#define AST_NONE (-1)
+
+// Flat node pool: node n is kind[n], op[n], a[n] and b[n], children are
+// indices into the same arrays. Nodes are appended in post-order
+// (children before their parent), so every subtree is a contiguous
+// index range ending at its root and statements appear in source order.
+//
+//   AST_DECLARATION   a = symbol
+//   AST_ASSIGNMENT    a = symbol, b = value
+//   AST_BINARY_OP     op, a = left, b = right
+//   AST_NUMBER        a = value
+//   AST_IDENTIFIER    a = symbol
+//   AST_CONDITIONAL   a = condition, b = block
+//   AST_PROGRAM       a = first entry in lists, b = statement count
+typedef struct {
+    unsigned char *kind;    // ASTType
+    unsigned char *op;      // BinaryOperator of AST_BINARY_OP nodes
+    int32_t *a;
+    int32_t *b;
+    int count;
+    int cap;
+    NodeId *lists;          // statements of every block, contiguous per block
+    int list_count;
+    int list_cap;
+    size_t bytes_peak;      // highest ast_bytes_used seen across resets
+    size_t grows;           // reallocations of the node and list arrays, across resets
+} AST;
+
+// bytes one node takes across the parallel arrays
+#define AST_NODE_BYTES (2 + 2 * sizeof(int32_t))
+
+#define AST_SYM(t, n)     ((t)->a[n])      // declaration, assignment, identifier
+#define AST_INT(t, n)     ((t)->a[n])      // number
+#define AST_EXPR(t, n)    ((t)->b[n])      // assigned value
+#define AST_LEFT(t, n)    ((t)->a[n])
+#define AST_RIGHT(t, n)   ((t)->b[n])
+#define AST_COND(t, n)    ((t)->a[n])
+#define AST_BLOCK(t, n)   ((t)->b[n])
+#define AST_STMTS(t, n)   ((t)->lists + (t)->a[n])
+#define AST_COUNT(t, n)   ((t)->b[n])
+
+// explicit work stack, so walking the tree does not recurse
+typedef struct {
+    NodeId *items;
+    int top;
+    int cap;
+} ASTStack;
+
+// Function declarations
+void init_ast(AST *t);
+void ast_reset(AST *t);
+void free_ast(AST *t);
+NodeId ast_add_node(AST *t, ASTType kind, int32_t a, int32_t b);
+int ast_add_list(AST *t, const NodeId *items, int count);
+NodeId ast_subtree_start(const AST *t, NodeId n);
+size_t ast_bytes_used(const AST *t);
+size_t ast_peak_bytes(const AST *t);
+void ast_stack_push(ASTStack *s, NodeId n);
+void free_ast_stack(ASTStack *s);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,236 @@
+// Parallel batch compilation driver
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "batch.h"
+#include "pool.h"
+
+// result of compiling one unit
+typedef struct {
+    const char *input;
+    char *output;
+    size_t bytes;
+    double ms;
+    int ok;
+    int cached;
+    char error[256];
+} BatchUnit;
+
+typedef struct {
+    BatchUnit *units;
+    Compiler *contexts;     // one warm context per worker
+    Cache *cache;           // NULL = always compile
+} BatchJob;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// foo.simplelang -> foo.asm, anything else gets .asm appended
+static char* output_path_for(const char *input) {
+    const char *ext = ".simplelang";
+    size_t len = strlen(input);
+    size_t ext_len = strlen(ext);
+    if (len > ext_len && strcmp(input + len - ext_len, ext) == 0) {
+        len -= ext_len;
+    }
+    char *out = (char*)malloc(len + 5);
+    if (!out) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    memcpy(out, input, len);
+    strcpy(out + len, ".asm");
+    return out;
+}
+
+static void compile_unit(void *arg, int task, int worker) {
+    BatchJob *job = (BatchJob*)arg;
+    BatchUnit *u = &job->units[task];
+    Compiler *ctx = &job->contexts[worker];
+    double start = now_ms();
+
+    SourceBuffer src;
+    if (!source_open(&src, u->input)) {
+        snprintf(u->error, sizeof(u->error), "Could not open file '%s'", u->input);
+        u->ms = now_ms() - start;
+        return;
+    }
+    u->bytes = src.len;
+
+    int fd = open(u->output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        snprintf(u->error, sizeof(u->error), "Could not create file '%s'", u->output);
+        source_close(&src);
+        u->ms = now_ms() - start;
+        return;
+    }
+
+    FdBuffer file_buf;
+    OutputSink file_out;
+    init_fd_sink(&file_out, &file_buf, fd);
+    OutputSink out;
+    if (job->cache) {
+        // with a cache the assembly is collected first so it can be stored
+        char key[65];
+        StringBuffer asm_text = { NULL, 0, 0 };
+        cache_key(&ctx->options, src.data, src.len, key);
+        if (cache_lookup(job->cache, key, &asm_text)) {
+            u->ok = 1;
+            u->cached = 1;
+        } else {
+            init_string_sink(&out, &asm_text);
+            if (compile_buffer(ctx, src.data, src.len, &out) == 0) {
+                u->ok = 1;
+                cache_store(job->cache, key, asm_text.data, asm_text.len);
+            } else {
+                snprintf(u->error, sizeof(u->error), "%s", compiler_error(ctx));
+            }
+        }
+        if (u->ok) {
+            sink_write(&file_out, asm_text.data, asm_text.len);
+        }
+        free_string_buffer(&asm_text);
+    } else {
+        if (compile_buffer(ctx, src.data, src.len, &file_out) == 0) {
+            u->ok = 1;
+        } else {
+            snprintf(u->error, sizeof(u->error), "%s", compiler_error(ctx));
+        }
+    }
+    int flushed = flush_fd_buffer(&file_buf);
+    if ((close(fd) != 0 || !flushed) && u->ok) {
+        u->ok = 0;
+        snprintf(u->error, sizeof(u->error), "Could not write file '%s'", u->output);
+    }
+    free_fd_buffer(&file_buf);
+    if (!u->ok) {
+        remove(u->output);
+    }
+    source_close(&src);
+    u->ms = now_ms() - start;
+}
+
+// read one input path per line, blank lines and '#' comments skipped
+char** read_manifest(const char *path, int *count) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return NULL;
+    }
+
+    int cap = 64;
+    int n = 0;
+    char **paths = (char**)malloc(sizeof(char*) * cap);
+    char line[4096];
+    while (paths && fgets(line, sizeof(line), f)) {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (len == 0 || line[0] == '#') {
+            continue;
+        }
+        if (n == cap) {
+            cap *= 2;
+            char **grown = (char**)realloc(paths, sizeof(char*) * cap);
+            if (!grown) {
+                break;
+            }
+            paths = grown;
+        }
+        paths[n] = (char*)malloc(len + 1);
+        if (!paths[n]) {
+            break;
+        }
+        memcpy(paths[n++], line, len + 1);
+    }
+    fclose(f);
+
+    *count = n;
+    return paths;
+}
+
+void free_manifest(char **paths, int count) {
+    for (int i = 0; i < count; i++) {
+        free(paths[i]);
+    }
+    free(paths);
+}
+
+// compile every input to its own .asm file on `jobs` threads and print
+// a per-unit timing summary; returns the number of failed units
+int batch_compile(const char **inputs, int count, int jobs, const CompileOptions *opts,
+                  Cache *cache) {
+    if (jobs < 1) {
+        jobs = pool_default_jobs();
+    }
+    if (jobs > count) {
+        jobs = count > 0 ? count : 1;
+    }
+
+    BatchJob job;
+    job.units = (BatchUnit*)calloc(count > 0 ? count : 1, sizeof(BatchUnit));
+    job.contexts = (Compiler*)malloc(sizeof(Compiler) * jobs);
+    job.cache = cache;
+    if (!job.units || !job.contexts) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        job.units[i].input = inputs[i];
+        job.units[i].output = output_path_for(inputs[i]);
+    }
+    for (int w = 0; w < jobs; w++) {
+        compiler_init(&job.contexts[w]);
+        job.contexts[w].options = *opts;
+    }
+
+    double start = now_ms();
+    pool_run(jobs, count, compile_unit, &job);
+    double wall = now_ms() - start;
+
+    printf("Batch Compilation Summary:\n");
+    printf("==========================\n");
+    int failed = 0;
+    int cached = 0;
+    size_t total_bytes = 0;
+    double cpu_ms = 0;
+    for (int i = 0; i < count; i++) {
+        BatchUnit *u = &job.units[i];
+        total_bytes += u->bytes;
+        cpu_ms += u->ms;
+        if (u->ok) {
+            cached += u->cached;
+            printf("  %-40s -> %-40s %10.3f ms%s\n", u->input, u->output, u->ms,
+                   u->cached ? " (cached)" : "");
+        } else {
+            failed++;
+            printf("  %-40s FAILED (%.3f ms): %s\n", u->input, u->ms, u->error);
+        }
+    }
+
+    double secs = wall / 1000.0;
+    printf("\nUnits: %d (%d ok, %d failed), jobs: %d\n", count, count - failed, failed, jobs);
+    if (cache) {
+        printf("Cache hits: %d of %d\n", cached, count);
+    }
+    printf("Wall time: %.3f ms (sum of unit times %.3f ms)\n", wall, cpu_ms);
+    if (secs > 0) {
+        printf("Throughput: %.1f units/s, %.2f MB/s\n",
+               count / secs, total_bytes / (1024.0 * 1024.0) / secs);
+    }
+
+    for (int w = 0; w < jobs; w++) {
+        compiler_free(&job.contexts[w]);
+    }
+    for (int i = 0; i < count; i++) {
+        free(job.units[i].output);
+    }
+    free(job.units);
+    free(job.contexts);
+    return failed;
+}
\ No newline at end of file
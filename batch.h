@@ -0,0 +1,13 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "compiler.h"
+#include "cache.h"
+
+// Function declarations
+char** read_manifest(const char *path, int *count);
+void free_manifest(char **paths, int count);
+int batch_compile(const char **inputs, int count, int jobs, const CompileOptions *opts,
+                  Cache *cache);
+
+#endif
\ No newline at end of file
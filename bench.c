@@ -0,0 +1,801 @@
+// Compiler throughput benchmark over synthetic workloads
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compiler.h"
+#include "workload.h"
+#include "stats.h"
+#include "scan.h"
+#include "simulate.h"
+
+#define MAX_SWEEP 16
+
+typedef struct {
+    int values[MAX_SWEEP];
+    int count;
+} Sweep;
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--statements N,...] [--variables N,...] [--expr-length N,...]\n", prog);
+    printf("       %*s [--depth N,...] [--nest N,...] [--codegen-jobs N,...]\n",
+           (int)strlen(prog), "");
+    printf("       %*s [--lex-jobs N,...] [--seed N] [--repeat N] [-O<level>]\n", (int)strlen(prog), "");
+    printf("       %s --generate [shape options]\n", prog);
+    printf("       %s --check-scan N\n", prog);
+    printf("       %s --check-expr N\n", prog);
+    printf("       %s --ast-layout [shape options]\n", prog);
+    printf("Compiles a synthetic program for every combination of the listed\n");
+    printf("shapes and prints one JSON object per line with the best of --repeat\n");
+    printf("runs (default 3). --generate prints the program for the first value\n");
+    printf("of each option instead. --nest wraps the statements in that many\n");
+    printf("nested if blocks. --codegen-jobs generates code on that many\n");
+    printf("threads and checks the assembly against one thread, --lex-jobs\n");
+    printf("does the same for lexing. --check-scan runs N random buffers through\n");
+    printf("every scan kernel set this CPU supports and the lexer on top of\n");
+    printf("them, comparing against the scalar kernels. --check-expr compiles N\n");
+    printf("programs with random expression trees at each optimization level\n");
+    printf("and checks their results on the simulator. --ast-layout times a\n");
+    printf("walk over the parsed tree in the flat node pool and in a copy\n");
+    printf("using pointer-linked nodes instead of compiling.\n");
+}
+
+// "1000,10000" -> values; 0 on a malformed list
+static int parse_sweep(Sweep *s, const char *arg) {
+    s->count = 0;
+    while (*arg && s->count < MAX_SWEEP) {
+        char *end;
+        long v = strtol(arg, &end, 10);
+        if (end == arg || v < 0 || (*end && *end != ',')) {
+            return 0;
+        }
+        s->values[s->count++] = (int)v;
+        arg = *end ? end + 1 : end;
+    }
+    return s->count > 0 && !*arg;
+}
+
+// times each phase of compile_source into the CompileStats
+typedef struct {
+    CompileStats *st;
+    double phase_ms;
+} PhaseTimer;
+
+static void timer_begin_phase(void *user, Compiler *ctx, CompilePhase phase, NodeId root) {
+    (void)ctx;
+    (void)phase;
+    (void)root;
+    ((PhaseTimer*)user)->phase_ms = stats_now_ms();
+}
+
+static void timer_end_phase(void *user, Compiler *ctx, CompilePhase phase) {
+    PhaseTimer *t = (PhaseTimer*)user;
+    (void)ctx;
+    stats_end_phase(t->st, phase, t->phase_ms);
+}
+
+// one timed compilation of src, phases as in the command line tool
+static void run_once(const StringBuffer *src, int mem_size, int opt_level, int jobs,
+                     int lex_jobs, CompileStats *st, StringBuffer *asm_text) {
+    SourceBuffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.data = src->data;
+    buf.len = src->len;
+    buf.eof = 1;
+
+    OutputSink out;
+    init_string_sink(&out, asm_text);
+    asm_text->len = 0;
+
+    init_compile_stats(st, "synthetic", src->len, opt_level);
+    double start_ms = stats_now_ms();
+
+    Compiler ctx;
+    compiler_init(&ctx);
+    ctx.options.mem_size = mem_size;
+    ctx.options.opt_level = opt_level;
+    ctx.codegen_jobs = jobs;
+    ctx.lex_jobs = lex_jobs;
+
+    if (lex_jobs <= 1) {
+        stats_time_lexing(st, &buf);
+    }
+    PhaseTimer timer = { st, 0.0 };
+    CompileHooks hooks = { &timer, timer_begin_phase, timer_end_phase, NULL };
+    if (compile_source(&ctx, &buf, &out, &hooks) != 0) {
+        printf("%s\n", compiler_error(&ctx));
+        exit(1);
+    }
+
+    st->tokens = ctx.parser.tokens;
+    st->ast_nodes = ctx.parser.nodes;
+    st->instructions = ctx.cg.instructions;
+    st->ast_peak = ast_peak_bytes(&ctx.ast);
+    compiler_free(&ctx);
+    stats_finish(st, start_ms);
+}
+
+// bytes the scan kernels treat differently, mixed with token text
+static const char *scan_pieces[] = {
+    " ", "  ", "\t", "\n", "\r\n", "\v\f", "        ", "\n\n\n    ",
+    "v1", "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ", "x9y8z7",
+    "0123456789", "42", "int", "if", "=", "==", "+", "-", "{", "}", "(", ")", ";",
+    "/", "// comment until the end of the line\n", "//", "@", "[", "`", "{", "\x80", "\xff", "_"
+};
+
+static unsigned int check_rng = 1;
+
+static unsigned int check_random(void) {
+    check_rng ^= check_rng << 13;
+    check_rng ^= check_rng >> 17;
+    check_rng ^= check_rng << 5;
+    return check_rng;
+}
+
+// token stream of buf lexed with kernels k, as text for comparison
+static void lex_all(const char *buf, size_t len, const ScanKernels *k, StringBuffer *tokens) {
+    Interner names;
+    Lexer lx;
+    Token t;
+    OutputSink out;
+    init_interner(&names);
+    init_lexer(&lx, buf, len, &names);
+    lx.scan = k;
+    init_string_sink(&out, tokens);
+    tokens->len = 0;
+    int more;
+    do {
+        more = getNextToken(&lx, &t);
+        sink_printf(&out, "%d %zu %zu %d %d %d\n", t.type, t.offset, t.length, t.line, t.column, t.sym);
+    } while (more);
+    free_interner(&names);
+}
+
+// compare every kernel set with the scalar one on random buffers; the
+// buffer is copied to the end of a heap block so reads past len would
+// be caught by a memory checker
+static int check_scan(int iterations) {
+    const ScanKernels *ref = scan_scalar_kernels();
+    int count = scan_kernel_count();
+    int failures = 0;
+    StringBuffer want = { NULL, 0, 0 };
+    StringBuffer got = { NULL, 0, 0 };
+    char text[4096];
+
+    for (int it = 0; it < iterations && failures < 10; it++) {
+        size_t len = 0;
+        int pieces = (int)(check_random() % 200);
+        for (int p = 0; p < pieces; p++) {
+            const char *s = scan_pieces[check_random() % (sizeof(scan_pieces) / sizeof(scan_pieces[0]))];
+            size_t n = strlen(s);
+            if (len + n > sizeof(text)) {
+                break;
+            }
+            memcpy(text + len, s, n);
+            len += n;
+        }
+        char *buf = (char*)malloc(len ? len : 1);
+        if (!buf) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        memcpy(buf, text, len);
+
+        lex_all(buf, len, ref, &want);
+        for (int i = 0; i < count; i++) {
+            const ScanKernels *k = scan_kernel_at(i);
+            for (size_t pos = 0; pos < len; pos++) {
+                int lines_a = 0, lines_b = 0;
+                size_t start_a = 0, start_b = 0;
+                size_t a = ref->skip_space(buf, pos, len, &lines_a, &start_a);
+                size_t b = k->skip_space(buf, pos, len, &lines_b, &start_b);
+                if (a != b || lines_a != lines_b || start_a != start_b ||
+                    ref->skip_ident(buf, pos, len) != k->skip_ident(buf, pos, len) ||
+                    ref->skip_digits(buf, pos, len) != k->skip_digits(buf, pos, len) ||
+                    ref->find_newline(buf, pos, len) != k->find_newline(buf, pos, len)) {
+                    printf("%s kernels differ from scalar at offset %zu of a %zu byte buffer\n",
+                           k->name, pos, len);
+                    failures++;
+                    break;
+                }
+            }
+            lex_all(buf, len, k, &got);
+            if (got.len != want.len || memcmp(got.data, want.data, got.len) != 0) {
+                printf("lexer with %s kernels differs from scalar on a %zu byte buffer\n", k->name, len);
+                failures++;
+            }
+        }
+        free(buf);
+    }
+
+    printf("Scan kernels checked:");
+    for (int i = 0; i < count; i++) {
+        printf(" %s", scan_kernel_at(i)->name);
+    }
+    printf(" (%d buffers, %d failures)\n", iterations, failures);
+    free_string_buffer(&want);
+    free_string_buffer(&got);
+    return failures ? 1 : 0;
+}
+
+// random tree of + and - over numbers and the variables in syms, with
+// leaves operands; its value mod 256 for the variables in vals
+static NodeId random_expr(AST *t, const int *syms, const int *vals, int leaves, int *value) {
+    if (leaves == 1) {
+        int v = (int)(check_random() % 5);
+        if (v == 4) {
+            *value = (int)(check_random() % 256);
+            return ast_add_node(t, AST_NUMBER, *value, 0);
+        }
+        *value = vals[v];
+        return ast_add_node(t, AST_IDENTIFIER, syms[v], 0);
+    }
+    int left_leaves = 1 + (int)(check_random() % (unsigned int)(leaves - 1));
+    int l, r;
+    NodeId left = random_expr(t, syms, vals, left_leaves, &l);
+    NodeId right = random_expr(t, syms, vals, leaves - left_leaves, &r);
+    NodeId n = ast_add_node(t, AST_BINARY_OP, left, right);
+    int sub = (int)(check_random() % 2);
+    t->op[n] = (unsigned char)(sub ? OP_SUB : OP_ADD);
+    *value = (sub ? l - r : l + r) & 255;
+    return n;
+}
+
+// program computing x = tree + (cond ? 1 : 0) with cond comparing two
+// more trees. The variables are set inside an if the optimizer cannot
+// decide, so the trees are lowered rather than folded; x is stored last
+// so slot packing keeps it. Returns the expected value of x.
+static int expr_program(AST *t, Interner *names, NodeId *root, int *x_sym) {
+    int syms[4], vals[4];
+    NodeId stmts[8], block[4];
+    int count = 0;
+    char name[4] = "v0";
+    int z = intern_symbol(names, "z", 1);
+    int y = intern_symbol(names, "y", 1);
+    *x_sym = intern_symbol(names, "x", 1);
+    stmts[count++] = ast_add_node(t, AST_DECLARATION, z, 0);
+    stmts[count++] = ast_add_node(t, AST_DECLARATION, y, 0);
+    stmts[count++] = ast_add_node(t, AST_DECLARATION, *x_sym, 0);
+
+    NodeId test = ast_add_node(t, AST_IDENTIFIER, z, 0);
+    NodeId cond = ast_add_node(t, AST_BINARY_OP, test, ast_add_node(t, AST_NUMBER, 0, 0));
+    t->op[cond] = OP_EQUAL;
+    for (int i = 0; i < 4; i++) {
+        name[1] = (char)('0' + i);
+        syms[i] = intern_symbol(names, name, 2);
+        vals[i] = (int)(check_random() % 256);
+        block[i] = ast_add_node(t, AST_ASSIGNMENT, syms[i], ast_add_node(t, AST_NUMBER, vals[i], 0));
+    }
+    NodeId body = ast_add_node(t, AST_PROGRAM, ast_add_list(t, block, 4), 4);
+    stmts[count++] = ast_add_node(t, AST_CONDITIONAL, cond, body);
+
+    int l, r;
+    NodeId left = random_expr(t, syms, vals, 1 + (int)(check_random() % 6), &l);
+    NodeId right = random_expr(t, syms, vals, 1 + (int)(check_random() % 6), &r);
+    cond = ast_add_node(t, AST_BINARY_OP, left, right);
+    t->op[cond] = OP_EQUAL;
+    NodeId set = ast_add_node(t, AST_ASSIGNMENT, y, ast_add_node(t, AST_NUMBER, 1, 0));
+    body = ast_add_node(t, AST_PROGRAM, ast_add_list(t, &set, 1), 1);
+    stmts[count++] = ast_add_node(t, AST_CONDITIONAL, cond, body);
+
+    int value;
+    NodeId tree = random_expr(t, syms, vals, 1 + (int)(check_random() % 16), &value);
+    NodeId sum = ast_add_node(t, AST_BINARY_OP, tree, ast_add_node(t, AST_IDENTIFIER, y, 0));
+    t->op[sum] = OP_ADD;
+    stmts[count++] = ast_add_node(t, AST_ASSIGNMENT, *x_sym, sum);
+    *root = ast_add_node(t, AST_PROGRAM, ast_add_list(t, stmts, count), count);
+    return (value + (l == r)) & 255;
+}
+
+// compile the program at root at level into image and run it on sim;
+// 0 on a compile or run error, with the message in ctx->err
+static int run_expr_program(Compiler *ctx, NodeId root, int level, OutputSink *out,
+                            MachineImage *image, Simulator *sim) {
+    init_codegen(&ctx->cg, ctx->options.mem_size, &ctx->names, out, &ctx->err);
+    set_peephole(&ctx->cg, level >= 1);
+    set_slot_packing(&ctx->cg, level >= 2);
+    set_machine_image(&ctx->cg, image);
+    if (setjmp(ctx->err.env) != 0) {
+        ctx->err.active = 0;
+        return 0;
+    }
+    ctx->err.active = 1;
+    collect_declarations(&ctx->cg, &ctx->ast, root);
+    if (level >= 1) {
+        optimize_program(&ctx->opt, &ctx->ast, root);
+    }
+    generate_code(&ctx->cg, &ctx->ast, root, 0);
+    run_simulator(sim, image, &ctx->err);
+    ctx->err.active = 0;
+    return 1;
+}
+
+// lower random expression trees at every optimization level, run them
+// on the simulator and compare with evaluating the trees directly
+static int check_expr(int iterations) {
+    int failures = 0;
+    StringBuffer text = { NULL, 0, 0 };
+    OutputSink out;
+    init_string_sink(&out, &text);
+    for (int it = 0; it < iterations && failures < 10; it++) {
+        unsigned int seed = check_rng;
+        for (int level = 0; level <= 2; level++) {
+            Compiler ctx;
+            compiler_init(&ctx);
+            check_rng = seed;
+            NodeId root;
+            int x;
+            int want = expr_program(&ctx.ast, &ctx.names, &root, &x);
+
+            text.len = 0;
+            MachineImage image;
+            Simulator sim;
+            init_image(&image, ctx.options.mem_size);
+            init_simulator(&sim, ctx.options.mem_size);
+            if (!run_expr_program(&ctx, root, level, &out, &image, &sim)) {
+                printf("-O%d: %s\n", level, ctx.err.msg);
+                failures++;
+            } else {
+                int got = sim.mem[find_variable(&ctx.cg, x)];
+                if (got != want) {
+                    printf("-O%d: x = %d, expected %d\n%.*s", level, got, want, (int)text.len, text.data);
+                    failures++;
+                }
+            }
+            free_simulator(&sim);
+            free_image(&image);
+            cleanup_codegen(&ctx.cg);
+            compiler_free(&ctx);
+        }
+    }
+    printf("Expression trees checked: %d programs at -O0 to -O2, %d failures\n", iterations, failures);
+    free_string_buffer(&text);
+    return failures ? 1 : 0;
+}
+
+static double per_second(double count, double ms) {
+    return ms > 0 ? count * 1000.0 / ms : 0.0;
+}
+
+// one JSON line per codegen and lexing thread count; returns 0 if a
+// parallel run printed different assembly than one thread
+static int bench_shape(const WorkloadParams *wp, int opt_level, int repeat, const Sweep *jobs,
+                       const Sweep *lex_jobs) {
+    StringBuffer src = { NULL, 0, 0 };
+    OutputSink out;
+    init_string_sink(&out, &src);
+    generate_workload(wp, &out);
+
+    // every variable needs its own address at -O0 and -O1
+    int mem_size = 100 + wp->variables;
+    if (mem_size < DEFAULT_DATA_MEM_SIZE) {
+        mem_size = DEFAULT_DATA_MEM_SIZE;
+    }
+
+    StringBuffer serial = { NULL, 0, 0 };
+    StringBuffer asm_text = { NULL, 0, 0 };
+    int all_same = 1;
+    for (int j = 0; j < jobs->count * lex_jobs->count; j++) {
+        int threads = jobs->values[j / lex_jobs->count] > 1 ? jobs->values[j / lex_jobs->count] : 1;
+        int lex_threads = lex_jobs->values[j % lex_jobs->count] > 1 ? lex_jobs->values[j % lex_jobs->count] : 1;
+
+        // best time per phase over all runs
+        CompileStats best, st;
+        run_once(&src, mem_size, opt_level, threads, lex_threads, &best, &asm_text);
+        for (int r = 1; r < repeat; r++) {
+            run_once(&src, mem_size, opt_level, threads, lex_threads, &st, &asm_text);
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                if (st.phase_ms[p] < best.phase_ms[p]) {
+                    best.phase_ms[p] = st.phase_ms[p];
+                }
+            }
+            if (st.total_ms < best.total_ms) {
+                best.total_ms = st.total_ms;
+            }
+            best.peak_rss_kb = st.peak_rss_kb;
+        }
+
+        int same = 1;
+        if (threads > 1 || lex_threads > 1) {
+            if (!serial.data) {
+                run_once(&src, mem_size, opt_level, 1, 1, &st, &serial);
+            }
+            same = asm_text.len == serial.len && memcmp(asm_text.data, serial.data, serial.len) == 0;
+            all_same = all_same && same;
+        }
+
+        double compile_ms = best.phase_ms[PHASE_PARSE] + best.phase_ms[PHASE_COLLECT] +
+                            best.phase_ms[PHASE_OPTIMIZE] + best.phase_ms[PHASE_CODEGEN];
+        printf("{\"version\": \"%s\", \"statements\": %d, \"variables\": %d, \"expr_length\": %d, "
+               "\"depth\": %d, \"nest\": %d, \"seed\": %u, \"opt_level\": %d, \"repeat\": %d, "
+               "\"codegen_jobs\": %d, \"lex_jobs\": %d, ",
+               COMPILER_VERSION, wp->statements, wp->variables, wp->expr_length, wp->depth,
+               wp->nest, wp->seed, opt_level, repeat, threads, lex_threads);
+        printf("\"source_bytes\": %zu, \"tokens\": %zu, \"ast_nodes\": %zu, \"instructions\": %zu, ",
+               best.source_bytes, best.tokens, best.ast_nodes, best.instructions);
+        printf("\"phases_ms\": {");
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            printf("%s\"%s\": %.3f", p ? ", " : "", stats_phase_name(p), best.phase_ms[p]);
+        }
+        printf("}, \"phase_heap_bytes\": {");
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            printf("%s\"%s\": %zu", p ? ", " : "", stats_phase_name(p), best.phase_heap[p]);
+        }
+        printf("}, \"lex_tokens_per_sec\": %.0f, \"parse_tokens_per_sec\": %.0f, "
+               "\"statements_per_sec\": %.0f, \"ast_peak_bytes\": %zu, \"peak_rss_kb\": %ld, "
+               "\"same_output\": %s}\n",
+               per_second((double)best.tokens, best.phase_ms[PHASE_LEX]),
+               per_second((double)best.tokens, best.phase_ms[PHASE_PARSE]),
+               per_second((double)wp->statements, compile_ms),
+               best.ast_peak, best.peak_rss_kb, same ? "true" : "false");
+        fflush(stdout);
+    }
+    free_string_buffer(&serial);
+    free_string_buffer(&asm_text);
+    free_string_buffer(&src);
+    return all_same;
+}
+
+// the pointer-linked node the AST used before the flat pool, for --ast-layout
+typedef struct LinkedNode {
+    ASTType type;
+    union {
+        struct {
+            int symbol;
+            struct LinkedNode *value;
+        } assignment;
+        struct {
+            BinaryOperator op;
+            struct LinkedNode *left;
+            struct LinkedNode *right;
+        } binary_op;
+        struct {
+            int value;
+        } number;
+        struct {
+            struct LinkedNode *condition;
+            struct LinkedNode *then_block;
+        } conditional;
+        struct {
+            struct LinkedNode **statements;
+            int count;
+        } program;
+    } data;
+} LinkedNode;
+
+// copy the pool into linked nodes placed one after another, as the
+// arena allocated them
+static LinkedNode* link_copy(const AST *t, LinkedNode **lists_out) {
+    LinkedNode *nodes = (LinkedNode*)malloc(sizeof(LinkedNode) * (t->count ? t->count : 1));
+    LinkedNode **lists = (LinkedNode**)malloc(sizeof(LinkedNode*) * (t->list_count ? t->list_count : 1));
+    if (!nodes || !lists) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    for (int i = 0; i < t->list_count; i++) {
+        lists[i] = &nodes[t->lists[i]];
+    }
+    for (NodeId n = 0; n < t->count; n++) {
+        LinkedNode *ln = &nodes[n];
+        memset(ln, 0, sizeof(*ln));
+        ln->type = (ASTType)t->kind[n];
+        switch (ln->type) {
+            case AST_DECLARATION:
+            case AST_IDENTIFIER:
+            case AST_NUMBER:
+                ln->data.number.value = t->a[n];
+                break;
+            case AST_ASSIGNMENT:
+                ln->data.assignment.symbol = AST_SYM(t, n);
+                ln->data.assignment.value = &nodes[AST_EXPR(t, n)];
+                break;
+            case AST_BINARY_OP:
+                ln->data.binary_op.op = (BinaryOperator)t->op[n];
+                ln->data.binary_op.left = &nodes[AST_LEFT(t, n)];
+                ln->data.binary_op.right = &nodes[AST_RIGHT(t, n)];
+                break;
+            case AST_CONDITIONAL:
+                ln->data.conditional.condition = &nodes[AST_COND(t, n)];
+                ln->data.conditional.then_block = &nodes[AST_BLOCK(t, n)];
+                break;
+            case AST_PROGRAM:
+                ln->data.program.statements = lists + t->a[n];
+                ln->data.program.count = AST_COUNT(t, n);
+                break;
+        }
+    }
+    *lists_out = (LinkedNode*)lists;
+    return nodes;
+}
+
+// preorder walk over every node, folding kinds and operands into a checksum
+static unsigned long long walk_pool(const AST *t, NodeId root, ASTStack *todo) {
+    unsigned long long sum = 0;
+    todo->top = 0;
+    ast_stack_push(todo, root);
+    while (todo->top > 0) {
+        NodeId n = todo->items[--todo->top];
+        sum = sum * 31 + t->kind[n];
+        switch (t->kind[n]) {
+            case AST_ASSIGNMENT:
+                sum += (unsigned)AST_SYM(t, n);
+                ast_stack_push(todo, AST_EXPR(t, n));
+                break;
+            case AST_BINARY_OP:
+                sum += t->op[n];
+                ast_stack_push(todo, AST_RIGHT(t, n));
+                ast_stack_push(todo, AST_LEFT(t, n));
+                break;
+            case AST_CONDITIONAL:
+                ast_stack_push(todo, AST_BLOCK(t, n));
+                ast_stack_push(todo, AST_COND(t, n));
+                break;
+            case AST_PROGRAM:
+                for (int i = AST_COUNT(t, n) - 1; i >= 0; i--) {
+                    ast_stack_push(todo, AST_STMTS(t, n)[i]);
+                }
+                break;
+            default:
+                sum += (unsigned)t->a[n];
+                break;
+        }
+    }
+    return sum;
+}
+
+static void push_linked(LinkedNode ***items, int *top, int *cap, LinkedNode *n) {
+    if (*top == *cap) {
+        *cap = *cap ? *cap * 2 : 256;
+        *items = (LinkedNode**)realloc(*items, sizeof(LinkedNode*) * *cap);
+        if (!*items) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+    }
+    (*items)[(*top)++] = n;
+}
+
+static unsigned long long walk_linked(LinkedNode *root, LinkedNode ***items, int *cap) {
+    unsigned long long sum = 0;
+    int top = 0;
+    push_linked(items, &top, cap, root);
+    while (top > 0) {
+        LinkedNode *n = (*items)[--top];
+        sum = sum * 31 + n->type;
+        switch (n->type) {
+            case AST_ASSIGNMENT:
+                sum += (unsigned)n->data.assignment.symbol;
+                push_linked(items, &top, cap, n->data.assignment.value);
+                break;
+            case AST_BINARY_OP:
+                sum += n->data.binary_op.op;
+                push_linked(items, &top, cap, n->data.binary_op.right);
+                push_linked(items, &top, cap, n->data.binary_op.left);
+                break;
+            case AST_CONDITIONAL:
+                push_linked(items, &top, cap, n->data.conditional.then_block);
+                push_linked(items, &top, cap, n->data.conditional.condition);
+                break;
+            case AST_PROGRAM:
+                for (int i = n->data.program.count - 1; i >= 0; i--) {
+                    push_linked(items, &top, cap, n->data.program.statements[i]);
+                }
+                break;
+            default:
+                sum += (unsigned)n->data.number.value;
+                break;
+        }
+    }
+    return sum;
+}
+
+// what collect_declarations visits: one pass over the subtree's index range
+static unsigned long long decls_pool(const AST *t, NodeId root) {
+    unsigned long long sum = 0;
+    for (NodeId n = ast_subtree_start(t, root); n <= root; n++) {
+        if (t->kind[n] == AST_DECLARATION || t->kind[n] == AST_ASSIGNMENT) {
+            sum = sum * 31 + (unsigned)AST_SYM(t, n);
+        }
+    }
+    return sum;
+}
+
+// the same with the linked layout, following statement lists into if blocks
+static unsigned long long decls_linked(LinkedNode *root, LinkedNode ***items, int *cap) {
+    unsigned long long sum = 0;
+    int top = 0;
+    push_linked(items, &top, cap, root);
+    while (top > 0) {
+        LinkedNode *n = (*items)[--top];
+        if (n->type == AST_DECLARATION || n->type == AST_ASSIGNMENT) {
+            sum = sum * 31 + (unsigned)n->data.assignment.symbol;
+        } else if (n->type == AST_CONDITIONAL) {
+            push_linked(items, &top, cap, n->data.conditional.then_block);
+        } else if (n->type == AST_PROGRAM) {
+            for (int i = n->data.program.count - 1; i >= 0; i--) {
+                push_linked(items, &top, cap, n->data.program.statements[i]);
+            }
+        }
+    }
+    return sum;
+}
+
+static double best_ms(double best, double start) {
+    double ms = stats_now_ms() - start;
+    return best < 0 || ms < best ? ms : best;
+}
+
+// time a full walk and the declaration scan on the flat pool and on a
+// pointer-linked copy of the same tree
+static int bench_layout(const WorkloadParams *wp, int repeat) {
+    StringBuffer src = { NULL, 0, 0 };
+    OutputSink out;
+    init_string_sink(&out, &src);
+    generate_workload(wp, &out);
+
+    SourceBuffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.data = src.data;
+    buf.len = src.len;
+    buf.eof = 1;
+    Compiler ctx;
+    compiler_init(&ctx);
+    parser_set_input(&ctx.parser, &buf);
+    NodeId root = parse_program(&ctx.parser);
+    const AST *t = &ctx.ast;
+
+    LinkedNode *lists;
+    LinkedNode *nodes = link_copy(t, &lists);
+    ASTStack todo = { NULL, 0, 0 };
+    LinkedNode **items = NULL;
+    int cap = 0;
+    double walk[2] = { -1, -1 }, decls[2] = { -1, -1 };
+    int same = 1;
+    for (int r = 0; r < repeat; r++) {
+        double start = stats_now_ms();
+        unsigned long long a = walk_pool(t, root, &todo);
+        walk[0] = best_ms(walk[0], start);
+        start = stats_now_ms();
+        unsigned long long b = walk_linked(&nodes[root], &items, &cap);
+        walk[1] = best_ms(walk[1], start);
+        start = stats_now_ms();
+        unsigned long long c = decls_pool(t, root);
+        decls[0] = best_ms(decls[0], start);
+        start = stats_now_ms();
+        unsigned long long d = decls_linked(&nodes[root], &items, &cap);
+        decls[1] = best_ms(decls[1], start);
+        same = same && a == b && c == d;
+    }
+
+    size_t linked_bytes = sizeof(LinkedNode) * (size_t)t->count + sizeof(LinkedNode*) * (size_t)t->list_count;
+    printf("{\"statements\": %d, \"variables\": %d, \"expr_length\": %d, \"depth\": %d, "
+           "\"nest\": %d, \"seed\": %u, \"repeat\": %d, \"ast_nodes\": %d, ",
+           wp->statements, wp->variables, wp->expr_length, wp->depth, wp->nest, wp->seed,
+           repeat, t->count);
+    printf("\"node_bytes\": {\"pool\": %d, \"linked\": %d}, "
+           "\"ast_bytes\": {\"pool\": %zu, \"linked\": %zu}, ",
+           (int)AST_NODE_BYTES, (int)sizeof(LinkedNode), ast_bytes_used(t), linked_bytes);
+    printf("\"walk_ms\": {\"pool\": %.3f, \"linked\": %.3f}, "
+           "\"declaration_scan_ms\": {\"pool\": %.3f, \"linked\": %.3f}, \"same_result\": %s}\n",
+           walk[0], walk[1], decls[0], decls[1], same ? "true" : "false");
+    fflush(stdout);
+
+    free(items);
+    free_ast_stack(&todo);
+    free(nodes);
+    free(lists);
+    compiler_free(&ctx);
+    free_string_buffer(&src);
+    return same;
+}
+
+int main(int argc, char *argv[]) {
+    WorkloadParams wp;
+    default_workload_params(&wp);
+    Sweep statements = { { 1000, 10000, 100000 }, 3 };
+    Sweep variables = { { wp.variables }, 1 };
+    Sweep expr_length = { { wp.expr_length }, 1 };
+    Sweep depth = { { wp.depth }, 1 };
+    Sweep nest = { { wp.nest }, 1 };
+    Sweep jobs = { { 1 }, 1 };
+    Sweep lex_jobs = { { 1 }, 1 };
+    int repeat = 3;
+    int opt_level = DEFAULT_OPT_LEVEL;
+    int generate = 0;
+    int check_iterations = 0;
+    int check_exprs = 0;
+    int layout = 0;
+    int ok = 1;
+
+    for (int i = 1; i < argc && ok; i++) {
+        if (strcmp(argv[i], "--statements") == 0 && i + 1 < argc) {
+            ok = parse_sweep(&statements, argv[++i]);
+        } else if (strcmp(argv[i], "--variables") == 0 && i + 1 < argc) {
+            ok = parse_sweep(&variables, argv[++i]);
+        } else if (strcmp(argv[i], "--expr-length") == 0 && i + 1 < argc) {
+            ok = parse_sweep(&expr_length, argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            ok = parse_sweep(&depth, argv[++i]);
+        } else if (strcmp(argv[i], "--nest") == 0 && i + 1 < argc) {
+            ok = parse_sweep(&nest, argv[++i]);
+        } else if (strcmp(argv[i], "--codegen-jobs") == 0 && i + 1 < argc) {
+            ok = parse_sweep(&jobs, argv[++i]);
+        } else if (strcmp(argv[i], "--lex-jobs") == 0 && i + 1 < argc) {
+            ok = parse_sweep(&lex_jobs, argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            wp.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+            ok = repeat > 0;
+        } else if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '9' &&
+                   argv[i][3] == '\0') {
+            opt_level = argv[i][2] - '0';
+        } else if (strcmp(argv[i], "--generate") == 0) {
+            generate = 1;
+        } else if (strcmp(argv[i], "--ast-layout") == 0) {
+            layout = 1;
+        } else if (strcmp(argv[i], "--check-scan") == 0 && i + 1 < argc) {
+            check_iterations = atoi(argv[++i]);
+            ok = check_iterations > 0;
+        } else if (strcmp(argv[i], "--check-expr") == 0 && i + 1 < argc) {
+            check_exprs = atoi(argv[++i]);
+            ok = check_exprs > 0;
+        } else {
+            ok = 0;
+        }
+    }
+    for (int i = 0; i < variables.count; i++) {
+        ok = ok && variables.values[i] > 0;
+    }
+    for (int i = 0; i < expr_length.count; i++) {
+        ok = ok && expr_length.values[i] > 0;
+    }
+    if (!ok) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (check_iterations) {
+        return check_scan(check_iterations);
+    }
+    if (check_exprs) {
+        return check_expr(check_exprs);
+    }
+    
+    if (generate) {
+        wp.statements = statements.values[0];
+        wp.variables = variables.values[0];
+        wp.expr_length = expr_length.values[0];
+        wp.depth = depth.values[0];
+        wp.nest = nest.values[0];
+        FdBuffer buf;
+        OutputSink out;
+        init_fd_sink(&out, &buf, 1);
+        generate_workload(&wp, &out);
+        int written = flush_fd_buffer(&buf);
+        free_fd_buffer(&buf);
+        return written ? 0 : 1;
+    }
+
+    int status = 0;
+    for (int s = 0; s < statements.count; s++) {
+        for (int v = 0; v < variables.count; v++) {
+            for (int e = 0; e < expr_length.count; e++) {
+                for (int d = 0; d < depth.count; d++) {
+                    for (int n = 0; n < nest.count; n++) {
+                        wp.statements = statements.values[s];
+                        wp.variables = variables.values[v];
+                        wp.expr_length = expr_length.values[e];
+                        wp.depth = depth.values[d];
+                        wp.nest = nest.values[n];
+                        int same = layout ? bench_layout(&wp, repeat)
+                                          : bench_shape(&wp, opt_level, repeat, &jobs, &lex_jobs);
+                        if (!same) {
+                            status = 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return status;
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+// Binary machine code backend with label fixups
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "binary.h"
+
+static void* bin_realloc(void *p, size_t size) {
+    void *grown = realloc(p, size);
+    if (!grown) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    return grown;
+}
+
+static int reg_field(char reg) {
+    return reg == 'A' ? 0 : 1;
+}
+
+// addresses wider than one byte are needed once data memory exceeds 256 bytes
+void init_image(MachineImage *img, int mem_size) {
+    memset(img, 0, sizeof(*img));
+    img->addr_bytes = mem_size > 256 ? 2 : 1;
+    img->bad_addr = -1;
+}
+
+void free_image(MachineImage *img) {
+    free(img->code);
+    free(img->label_addr);
+    free(img->fixups);
+    free(img->lines);
+    memset(img, 0, sizeof(*img));
+}
+
+static void put_byte(MachineImage *img, unsigned char b) {
+    if (img->len == img->cap) {
+        img->cap = img->cap ? img->cap * 2 : 1024;
+        img->code = (unsigned char*)bin_realloc(img->code, img->cap);
+    }
+    img->code[img->len++] = b;
+}
+
+// an address that does not fit is reported by finish_image
+static void put_addr(MachineImage *img, long addr) {
+    if ((unsigned long)addr >> (8 * img->addr_bytes) != 0 && img->bad_addr < 0) {
+        img->bad_addr = addr;
+    }
+    for (int i = 0; i < img->addr_bytes; i++) {
+        put_byte(img, (unsigned char)(addr >> (8 * i)));
+    }
+}
+
+static void put_code_addr(MachineImage *img, long addr) {
+    put_byte(img, (unsigned char)addr);
+    put_byte(img, (unsigned char)(addr >> 8));
+}
+
+static void reserve_label(MachineImage *img, int label) {
+    if (label < img->label_cap) {
+        return;
+    }
+    int cap = img->label_cap ? img->label_cap : 64;
+    while (cap <= label) {
+        cap *= 2;
+    }
+    img->label_addr = (long*)bin_realloc(img->label_addr, sizeof(long) * cap);
+    for (int i = img->label_cap; i < cap; i++) {
+        img->label_addr[i] = -1;
+    }
+    img->label_cap = cap;
+}
+
+// jump operand: known labels are encoded directly, forward ones later
+static void put_label_ref(MachineImage *img, int label) {
+    reserve_label(img, label);
+    if (img->label_addr[label] >= 0) {
+        put_code_addr(img, img->label_addr[label]);
+        return;
+    }
+    if (img->fixup_count == img->fixup_cap) {
+        img->fixup_cap = img->fixup_cap ? img->fixup_cap * 2 : 64;
+        img->fixups = (Fixup*)bin_realloc(img->fixups, sizeof(Fixup) * img->fixup_cap);
+    }
+    img->fixups[img->fixup_count].at = img->len;
+    img->fixups[img->fixup_count].label = label;
+    img->fixup_count++;
+    put_code_addr(img, 0);
+}
+
+static void add_listing_line(MachineImage *img, size_t offset, const IRInstr *in) {
+    if (img->line_count == img->line_cap) {
+        img->line_cap = img->line_cap ? img->line_cap * 2 : 256;
+        img->lines = (ListingLine*)bin_realloc(img->lines, sizeof(ListingLine) * img->line_cap);
+    }
+    img->lines[img->line_count].offset = offset;
+    img->lines[img->line_count].in = *in;
+    img->line_count++;
+}
+
+// append the machine code for ir
+void encode_ir(MachineImage *img, const IRBuffer *ir) {
+    for (int i = 0; i < ir->count; i++) {
+        const IRInstr *in = &ir->code[i];
+        size_t start = img->len;
+        switch (in->op) {
+            case IR_COMMENT:
+                break;
+            case IR_LABEL:
+                reserve_label(img, in->value);
+                img->label_addr[in->value] = (long)img->len;
+                break;
+            case IR_LDI:
+                put_byte(img, OPC_LDI | reg_field(in->reg));
+                put_byte(img, (unsigned char)in->value);
+                break;
+            case IR_LOAD:
+                put_byte(img, OPC_MOV | reg_field(in->reg) << 3 | REG_FIELD_M);
+                put_addr(img, in->value);
+                break;
+            case IR_STORE:
+                put_byte(img, OPC_MOV | REG_FIELD_M << 3 | reg_field(in->reg));
+                put_addr(img, in->value);
+                break;
+            case IR_MOV:
+                put_byte(img, OPC_MOV | reg_field(in->reg) << 3 | reg_field(in->src));
+                break;
+            case IR_ADD:
+                put_byte(img, OPC_ADD);
+                break;
+            case IR_SUB:
+                put_byte(img, OPC_SUB);
+                break;
+            case IR_CMP:
+                put_byte(img, OPC_CMP);
+                break;
+            case IR_JMP:
+                put_byte(img, OPC_JMP);
+                put_label_ref(img, in->value);
+                break;
+            case IR_JNZ:
+                put_byte(img, OPC_JNZ);
+                put_label_ref(img, in->value);
+                break;
+        }
+        add_listing_line(img, start, in);
+    }
+}
+
+// append hlt and patch every forward jump
+void finish_image(MachineImage *img, ErrorHandler *err) {
+    IRInstr hlt;
+    memset(&hlt, 0, sizeof(hlt));
+    hlt.op = IR_COMMENT;
+    hlt.text = "hlt\n";
+    hlt.value = -1;
+    add_listing_line(img, img->len, &hlt);
+    put_byte(img, OPC_HLT);
+
+    for (int i = 0; i < img->fixup_count; i++) {
+        Fixup *f = &img->fixups[i];
+        long addr = f->label < img->label_cap ? img->label_addr[f->label] : -1;
+        if (addr < 0) {
+            raise_error(err, "Undefined label %d in machine code", f->label);
+        }
+        img->code[f->at] = (unsigned char)addr;
+        img->code[f->at + 1] = (unsigned char)(addr >> 8);
+    }
+    img->fixup_count = 0;
+
+    if (img->bad_addr >= 0) {
+        raise_error(err, "Data address %ld does not fit a %d-byte address field",
+                    img->bad_addr, img->addr_bytes);
+    }
+    if (img->len > MAX_CODE_BYTES) {
+        raise_error(err, "Program too large: %zu bytes of code, at most %d can be addressed",
+                    img->len, MAX_CODE_BYTES);
+    }
+}
+
+// the whole image goes out in one unbuffered write
+int write_image(const MachineImage *img, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return 0;
+    }
+    setvbuf(f, NULL, _IONBF, 0);
+    int ok = fwrite(img->code, 1, img->len, f) == img->len;
+    return fclose(f) == 0 && ok;
+}
+
+// address, encoded bytes and assembly text of every instruction
+void write_listing(const MachineImage *img, const Interner *names, OutputSink *out) {
+    for (int i = 0; i < img->line_count; i++) {
+        const ListingLine *l = &img->lines[i];
+        size_t end = i + 1 < img->line_count ? img->lines[i + 1].offset : img->len;
+        char bytes[16] = "";
+        int n = 0;
+        for (size_t b = l->offset; b < end && n + 3 < (int)sizeof(bytes); b++) {
+            n += snprintf(bytes + n, sizeof(bytes) - n, "%02x ", img->code[b]);
+        }
+        if (end == l->offset) {
+            // comments and labels take no bytes
+            sink_printf(out, "%4s  %-12s  ", "", "");
+        } else {
+            sink_printf(out, "%04zx  %-12s  ", l->offset, bytes);
+        }
+        print_instr(&l->in, names, out);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <stddef.h>
+#include "ir.h"
+#include "error.h"
+
+// Machine code for the 8-bit CPU. Each instruction is one opcode byte,
+// optionally followed by an operand: an immediate byte, a data address
+// of addr_bytes bytes (1 when data memory is at most 256 bytes, else 2)
+// or a 2-byte code address; multi-byte operands are little-endian.
+// Register fields use A = 000, B = 001, M = 111.
+//
+//   mov r s          01 rrr sss
+//   mov r M addr     01 rrr 111   data addr
+//   mov M r addr     01 111 rrr   data addr
+//   ldi r imm        00 010 rrr   imm
+//   jmp addr         00 011 000   code addr
+//   jnz addr         00 011 010   code addr
+//   add              10 000 000
+//   sub              10 001 000
+//   cmp              10 111 000
+//   hlt              00 000 001
+#define OPC_MOV     0x40
+#define OPC_LDI     0x10
+#define OPC_JMP     0x18
+#define OPC_JNZ     0x1A
+#define OPC_ADD     0x80
+#define OPC_SUB     0x88
+#define OPC_CMP     0xB8
+#define OPC_HLT     0x01
+#define REG_FIELD_M 7
+
+// code addresses are 16 bits wide, data addresses at most 16
+#define MAX_CODE_BYTES 65536
+#define MAX_DATA_MEM_SIZE 65536
+
+// jump operand waiting for its label's address
+typedef struct {
+    size_t at;
+    int label;
+} Fixup;
+
+// instruction as encoded, for the listing
+typedef struct {
+    size_t offset;
+    IRInstr in;
+} ListingLine;
+
+typedef struct {
+    unsigned char *code;
+    size_t len;
+    size_t cap;
+    int addr_bytes;         // width of data addresses
+    long bad_addr;          // first data address too wide for addr_bytes, -1 if none
+    long *label_addr;       // indexed by label number, -1 = not yet defined
+    int label_cap;
+    Fixup *fixups;
+    int fixup_count;
+    int fixup_cap;
+    ListingLine *lines;
+    int line_count;
+    int line_cap;
+} MachineImage;
+
+// Function declarations
+void init_image(MachineImage *img, int mem_size);
+void encode_ir(MachineImage *img, const IRBuffer *ir);
+void finish_image(MachineImage *img, ErrorHandler *err);
+int write_image(const MachineImage *img, const char *path);
+void write_listing(const MachineImage *img, const Interner *names, OutputSink *out);
+void free_image(MachineImage *img);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,406 @@
+// Content-addressed on-disk cache of generated assembly
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "sha256.h"
+
+#define STALE_TEMP_SECONDS 600
+
+// shared counters kept in <dir>/stats, guarded by <dir>/lock
+typedef struct {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long stores;
+    unsigned long long evictions;
+    unsigned long long bytes;
+} CacheCounters;
+
+typedef struct {
+    char *path;
+    struct timespec mtime;
+    unsigned long long size;
+} CacheEntry;
+
+// fcntl locks are per process, so threads also take this mutex
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static char* join_path(const char *dir, const char *name) {
+    size_t dlen = strlen(dir);
+    size_t nlen = strlen(name);
+    char *p = (char*)malloc(dlen + nlen + 2);
+    if (!p) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    memcpy(p, dir, dlen);
+    p[dlen] = '/';
+    memcpy(p + dlen + 1, name, nlen + 1);
+    return p;
+}
+
+// <dir>/ab/cdef... for key abcdef...
+static char* entry_path(Cache *c, const char *key) {
+    char name[67];
+    memcpy(name, key, 2);
+    name[2] = '/';
+    memcpy(name + 3, key + 2, 63);
+    return join_path(c->dir, name);
+}
+
+static int make_dirs(const char *path) {
+    char *p = (char*)malloc(strlen(path) + 1);
+    if (!p) {
+        return 0;
+    }
+    strcpy(p, path);
+    for (char *s = p + 1; ; s++) {
+        if (*s == '/' || *s == '\0') {
+            char saved = *s;
+            *s = '\0';
+            if (mkdir(p, 0755) != 0 && errno != EEXIST) {
+                free(p);
+                return 0;
+            }
+            *s = saved;
+            if (saved == '\0') {
+                break;
+            }
+        }
+    }
+    free(p);
+
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// write to a temp file in the same directory, then rename over the
+// destination so readers see either nothing or the complete file
+static int write_atomic(const char *dir, const char *dest, const char *data, size_t len) {
+    char *tmp = join_path(dir, ".tmp.XXXXXX");
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        free(tmp);
+        return 0;
+    }
+    fchmod(fd, 0644);
+
+    int ok = 1;
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ok = 0;
+            break;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    if (close(fd) != 0) {
+        ok = 0;
+    }
+    if (ok && rename(tmp, dest) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        unlink(tmp);
+    }
+    free(tmp);
+    return ok;
+}
+
+static int lock_cache(Cache *c) {
+    pthread_mutex_lock(&cache_mutex);
+    char *path = join_path(c->dir, "lock");
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    free(path);
+    if (fd < 0) {
+        pthread_mutex_unlock(&cache_mutex);
+        return -1;
+    }
+
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) != 0) {
+        if (errno != EINTR) {
+            close(fd);
+            pthread_mutex_unlock(&cache_mutex);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+// closing the descriptor drops the fcntl lock
+static void unlock_cache(int fd) {
+    close(fd);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+static void read_counters(Cache *c, CacheCounters *k) {
+    memset(k, 0, sizeof(*k));
+    char *path = join_path(c->dir, "stats");
+    FILE *f = fopen(path, "r");
+    free(path);
+    if (!f) {
+        return;
+    }
+    if (fscanf(f, "%llu %llu %llu %llu %llu", &k->hits, &k->misses, &k->stores,
+               &k->evictions, &k->bytes) != 5) {
+        memset(k, 0, sizeof(*k));
+    }
+    fclose(f);
+}
+
+static void write_counters(Cache *c, const CacheCounters *k) {
+    char line[160];
+    int n = snprintf(line, sizeof(line), "%llu %llu %llu %llu %llu\n", k->hits, k->misses,
+                     k->stores, k->evictions, k->bytes);
+    char *path = join_path(c->dir, "stats");
+    write_atomic(c->dir, path, line, (size_t)n);
+    free(path);
+}
+
+static int older_first(const void *a, const void *b) {
+    const CacheEntry *x = (const CacheEntry*)a;
+    const CacheEntry *y = (const CacheEntry*)b;
+    if (x->mtime.tv_sec != y->mtime.tv_sec) {
+        return x->mtime.tv_sec < y->mtime.tv_sec ? -1 : 1;
+    }
+    if (x->mtime.tv_nsec != y->mtime.tv_nsec) {
+        return x->mtime.tv_nsec < y->mtime.tv_nsec ? -1 : 1;
+    }
+    return 0;
+}
+
+// walk every entry to recount the total size, dropping temp files left
+// by crashed writers; with limit > 0 the least recently used entries
+// are removed until the total fits. Caller holds the lock.
+static int scan_entries(Cache *c, unsigned long long limit, CacheCounters *k) {
+    CacheEntry *entries = NULL;
+    int count = 0;
+    int cap = 0;
+    unsigned long long total = 0;
+    time_t now = time(NULL);
+
+    for (int b = 0; b < 256; b++) {
+        char sub[3];
+        snprintf(sub, sizeof(sub), "%02x", b);
+        char *subdir = join_path(c->dir, sub);
+        DIR *d = opendir(subdir);
+        if (!d) {
+            free(subdir);
+            continue;
+        }
+
+        struct dirent *de;
+        while ((de = readdir(d)) != NULL) {
+            if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+                continue;
+            }
+            char *path = join_path(subdir, de->d_name);
+            struct stat st;
+            if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+                free(path);
+                continue;
+            }
+            if (de->d_name[0] == '.') {
+                if (now - st.st_mtime > STALE_TEMP_SECONDS) {
+                    unlink(path);
+                }
+                free(path);
+                continue;
+            }
+
+            if (count == cap) {
+                cap = cap ? cap * 2 : 256;
+                CacheEntry *grown = (CacheEntry*)realloc(entries, sizeof(CacheEntry) * cap);
+                if (!grown) {
+                    printf("Memory allocation failed\n");
+                    exit(1);
+                }
+                entries = grown;
+            }
+            entries[count].path = path;
+            entries[count].mtime = st.st_mtim;
+            entries[count].size = (unsigned long long)st.st_size;
+            total += entries[count].size;
+            count++;
+        }
+        closedir(d);
+        free(subdir);
+    }
+
+    if (limit > 0 && total > limit) {
+        qsort(entries, count, sizeof(CacheEntry), older_first);
+        for (int i = 0; i < count && total > limit; i++) {
+            if (unlink(entries[i].path) == 0) {
+                total -= entries[i].size;
+                k->evictions++;
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(entries[i].path);
+    }
+    free(entries);
+    k->bytes = total;
+    return count;
+}
+
+int cache_open(Cache *c, const char *dir, unsigned long long max_bytes) {
+    c->dir = NULL;
+    c->max_bytes = max_bytes;
+    if (!make_dirs(dir)) {
+        return 0;
+    }
+    c->dir = (char*)malloc(strlen(dir) + 1);
+    if (!c->dir) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    strcpy(c->dir, dir);
+    return 1;
+}
+
+void cache_close(Cache *c) {
+    free(c->dir);
+    c->dir = NULL;
+}
+
+// everything that can change the output goes into the key; key=2 marks
+// keys that record the slot packing mode, which --incremental turns off
+void cache_key(const CompileOptions *opts, const char *src, size_t len, char key[65]) {
+    char header[80];
+    int n = snprintf(header, sizeof(header), "simplelang key=2 %s mem_size=%d opt=%d pack=%d",
+                     COMPILER_VERSION, opts->mem_size, opts->opt_level, compiler_packs_slots(opts));
+    unsigned char digest[32];
+    Sha256 h;
+    sha256_init(&h);
+    sha256_update(&h, header, (size_t)n + 1);
+    sha256_update(&h, src, len);
+    sha256_final(&h, digest);
+    sha256_hex(digest, key);
+}
+
+// append the stored assembly to out; a hit also marks the entry as
+// recently used by touching its mtime
+int cache_lookup(Cache *c, const char *key, StringBuffer *out) {
+    char *path = entry_path(c, key);
+    int fd = open(path, O_RDONLY);
+    free(path);
+
+    int hit = 0;
+    if (fd >= 0) {
+        OutputSink sink;
+        init_string_sink(&sink, out);
+        size_t start = out->len;
+        char block[16384];
+        hit = 1;
+        for (;;) {
+            ssize_t n = read(fd, block, sizeof(block));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                out->len = start;
+                hit = 0;
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            sink_write(&sink, block, (size_t)n);
+        }
+        if (hit) {
+            futimens(fd, NULL);
+        }
+        close(fd);
+    }
+
+    int lock = lock_cache(c);
+    if (lock >= 0) {
+        CacheCounters k;
+        read_counters(c, &k);
+        if (hit) {
+            k.hits++;
+        } else {
+            k.misses++;
+        }
+        write_counters(c, &k);
+        unlock_cache(lock);
+    }
+    return hit;
+}
+
+// store failures are silent: the cache is only an accelerator
+void cache_store(Cache *c, const char *key, const char *data, size_t len) {
+    char sub[3] = { key[0], key[1], '\0' };
+    char *subdir = join_path(c->dir, sub);
+    char *path = entry_path(c, key);
+    struct stat st;
+    int existed = stat(path, &st) == 0;
+
+    if (!((mkdir(subdir, 0755) == 0 || errno == EEXIST) &&
+          write_atomic(subdir, path, data, len))) {
+        free(subdir);
+        free(path);
+        return;
+    }
+    free(subdir);
+    free(path);
+
+    int lock = lock_cache(c);
+    if (lock < 0) {
+        return;
+    }
+    CacheCounters k;
+    read_counters(c, &k);
+    k.stores++;
+    k.bytes += len;
+    if (existed) {
+        k.bytes -= (unsigned long long)st.st_size;
+    }
+    if (c->max_bytes > 0 && k.bytes > c->max_bytes) {
+        // evict down to 90% so the next few stores skip the scan
+        scan_entries(c, c->max_bytes - c->max_bytes / 10, &k);
+    }
+    write_counters(c, &k);
+    unlock_cache(lock);
+}
+
+int cache_print_stats(Cache *c) {
+    int lock = lock_cache(c);
+    if (lock < 0) {
+        printf("Could not lock cache '%s'\n", c->dir);
+        return 1;
+    }
+    CacheCounters k;
+    read_counters(c, &k);
+    int entries = scan_entries(c, 0, &k);
+    write_counters(c, &k);
+    unlock_cache(lock);
+
+    unsigned long long lookups = k.hits + k.misses;
+    printf("Compile Cache Statistics:\n");
+    printf("=========================\n");
+    printf("Directory: %s\n", c->dir);
+    printf("Lookups: %llu (%llu hits, %llu misses)\n", lookups, k.hits, k.misses);
+    printf("Hit rate: %.1f%%\n", lookups ? 100.0 * k.hits / lookups : 0.0);
+    printf("Entries: %d (%llu bytes, limit %llu bytes)\n", entries, k.bytes, c->max_bytes);
+    printf("Stores: %llu, evictions: %llu\n", k.stores, k.evictions);
+    return 0;
+}
\ No newline at end of file
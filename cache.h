@@ -0,0 +1,26 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include "compiler.h"
+#include "output.h"
+
+#define DEFAULT_CACHE_MAX_BYTES (64ULL * 1024 * 1024)
+
+// Content-addressed store of generated assembly. Entries live in
+// <dir>/<2 hex>/<62 hex> keyed by SHA-256 of compiler version, options
+// and source; several processes may share one directory.
+typedef struct {
+    char *dir;
+    unsigned long long max_bytes;   // LRU eviction keeps the total below this
+} Cache;
+
+// Function declarations
+int cache_open(Cache *c, const char *dir, unsigned long long max_bytes);
+void cache_close(Cache *c);
+void cache_key(const CompileOptions *opts, const char *src, size_t len, char key[65]);
+int cache_lookup(Cache *c, const char *key, StringBuffer *out);
+void cache_store(Cache *c, const char *key, const char *data, size_t len);
+int cache_print_stats(Cache *c);
+
+#endif
\ No newline at end of file
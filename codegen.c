@@ -1,203 +1,594 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#ifndef CODEGEN_H
-#include "parser.h"
-
-// variable tracking
-typedef struct var_entry {
-    char *name;
-    int addr;
-} Variable;
-
-typedef struct cg_state_type {
-    Variable vars[26];
-    int var_idx;
-    int next_addr;
-    int label_num;
-} CodeGenState;
-
-static CodeGenState cg;
-
-void init_codegen(void) {
-    cg.var_idx = 0;
-    cg.next_addr = 100;
-    cg.label_num = 0;
-}
-
-void cleanup_codegen(void) {
-    for (int i = 0; i < cg.var_idx; i++) {
-        free(cg.vars[i].name);
-    }
-    cg.var_idx = 0;
-}
-
-// add variable to symbol table
-int add_variable(char *var_name) {
-    // check if already exists
-    for (int i = 0; i < cg.var_idx; i++) {
-        if (strcmp(cg.vars[i].name, var_name) == 0) {
-            return cg.vars[i].addr;
-        }
-    }
-    
-    if (cg.var_idx >= 26) {
-        printf("Too many variables!\n");
-        exit(1);
-    }
-    
-    cg.vars[cg.var_idx].name = (char*)malloc(strlen(var_name) + 1);
-    strcpy(cg.vars[cg.var_idx].name, var_name);
-    cg.vars[cg.var_idx].addr = cg.next_addr++;
-    
-    return cg.vars[cg.var_idx++].addr;
-}
-
-// get variable address
-int get_variable_address(char *var_name) {
-    for (int i = 0; i < cg.var_idx; i++) {
-        if (strcmp(cg.vars[i].name, var_name) == 0) {
-            return cg.vars[i].addr;
-        }
-    }
-    printf("Variable '%s' not found\n", var_name);
-    exit(1);
-}
-
-// collect all declarations first
-void collect_declarations(ASTNode *node) {
-    if (!node) return;
-    
-    switch (node->type) {
-        case AST_PROGRAM:
-            for (int i = 0; i < node->data.program.count; i++) {
-                collect_declarations(node->data.program.statements[i]);
-            }
-            break;
-        case AST_DECLARATION:
-            add_variable(node->data.declaration.variable_name);
-            break;
-        case AST_ASSIGNMENT:
-            // implicit declaration for assignments
-            add_variable(node->data.assignment.variable_name);
-            collect_declarations(node->data.assignment.value);
-            break;
-        case AST_CONDITIONAL:
-            collect_declarations(node->data.conditional.condition);
-            collect_declarations(node->data.conditional.then_block);
-            break;
-        case AST_BINARY_OP:
-            collect_declarations(node->data.binary_op.left);
-            collect_declarations(node->data.binary_op.right);
-            break;
-        default:
-            break;
-    }
-}
-
-// generate code for expressions
-int gen_expr_code(ASTNode *expr) {
-    if (!expr) return 0;
-    
-    switch (expr->type) {
-        case AST_NUMBER:
-            printf("ldi A %d\n", expr->data.number.value);
-            return 0;
-            
-        case AST_IDENTIFIER:
-            {
-                int addr = get_variable_address(expr->data.identifier.name);
-                printf("mov A M %d\n", addr);
-                return 0;
-            }
-            
-        case AST_BINARY_OP:
-            gen_expr_code(expr->data.binary_op.left);
-            
-            if (expr->data.binary_op.op == OP_EQUAL) {
-                // comparison operation
-                printf("mov A M %d\n", get_variable_address(expr->data.binary_op.left->data.identifier.name));
-                printf("ldi B %d\n", expr->data.binary_op.right->data.number.value);
-                printf("cmp\n");
-                return 1; // indicates comparison
-            } else {
-                // addition
-                printf("mov B A\n");
-                gen_expr_code(expr->data.binary_op.right);
-                printf("add\n");
-                return 0;
-            }
-            
-        default:
-            // handle unsupported AST types
-            break;
-    }
-    return 0;
-}
-
-// generate assembly code
-void generate_code(ASTNode *node, int depth) {
-    if (!node) return;
-    
-    switch (node->type) {
-        case AST_PROGRAM:
-            printf(".text\n");
-            for (int i = 0; i < node->data.program.count; i++) {
-                generate_code(node->data.program.statements[i], depth);
-            }
-            
-            printf("\n.data\n");
-            for (int i = 0; i < cg.var_idx; i++) {
-                printf("%s_addr = %d\n", cg.vars[i].name, cg.vars[i].addr);
-            }
-            printf("hlt\n");
-            break;
-            
-        case AST_DECLARATION:
-            // declarations handled in collect_declarations
-            break;
-            
-        case AST_ASSIGNMENT:
-            printf("; %s = ...\n", node->data.assignment.variable_name);
-            gen_expr_code(node->data.assignment.value);
-            int addr = get_variable_address(node->data.assignment.variable_name);
-            printf("mov M A %d\n", addr);
-            break;
-            
-        case AST_CONDITIONAL:
-            {
-                printf("; if (condition) {\n");
-                
-                gen_expr_code(node->data.conditional.condition);
-                
-                int else_lbl = cg.label_num++;
-                int end_lbl = cg.label_num++;
-                
-                printf("jnz else_%d\n", else_lbl);
-                printf(".text\n");
-                
-                generate_code(node->data.conditional.then_block, depth + 1);
-                
-                printf("\n.data\n");
-                for (int i = 0; i < cg.var_idx; i++) {
-                    printf("%s_addr = %d\n", cg.vars[i].name, cg.vars[i].addr);
-                }
-                printf("jmp end_%d\n", end_lbl);
-                printf("else_%d:\n", else_lbl);
-                printf("end_%d:\n", end_lbl);
-                printf("hlt\n");
-                
-                printf("\n.data\n");
-                for (int i = 0; i < cg.var_idx; i++) {
-                    printf("%s_addr = %d\n", cg.vars[i].name, cg.vars[i].addr);
-                }
-            }
-            break;
-            
-        default:
-            printf("Unknown node type for code generation\n");
-            exit(1);
-    }
-}
-
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#ifndef CODEGEN_H
+#include "codegen.h"
+#include "parser.h"
+#include "intern.h"
+#include "slots.h"
+#include "parallel.h"
+
+#define DATA_BASE_ADDR 100
+
+
+// write one formatted line of assembly to the output sink
+static void emit(CodeGenState *cg, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    sink_vprintf(cg->out, fmt, ap);
+    va_end(ap);
+}
+
+static void* cg_alloc(size_t size) {
+    void *p = malloc(size);
+    if (!p) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    return p;
+}
+
+// multiplicative hash, symbol IDs are dense so this spreads them well
+static int slot_for(CodeGenState *cg, int sym) {
+    return (int)(((unsigned int)sym * 2654435761u) & (unsigned int)cg->slot_mask);
+}
+
+// allocate an empty slot table with room for capacity entries
+static void alloc_slots(CodeGenState *cg, int capacity) {
+    int size = 16;
+    while (size < capacity * 2) {
+        size *= 2;
+    }
+    cg->slots = (int*)cg_alloc(sizeof(int) * size);
+    for (int i = 0; i < size; i++) {
+        cg->slots[i] = -1;
+    }
+    cg->slot_mask = size - 1;
+}
+
+// double the slot table and reinsert all variables
+static void grow_slots(CodeGenState *cg) {
+    int capacity = cg->slot_mask + 1;
+    free(cg->slots);
+    alloc_slots(cg, capacity);
+    for (int v = 0; v < cg->var_idx; v++) {
+        int i = slot_for(cg, cg->vars[v].sym);
+        while (cg->slots[i] != -1) {
+            i = (i + 1) & cg->slot_mask;
+        }
+        cg->slots[i] = v;
+    }
+}
+
+// find table slot for sym (either holding it or the empty slot to use)
+static int find_slot(CodeGenState *cg, int sym) {
+    int i = slot_for(cg, sym);
+    cg->var_lookups++;
+    cg->var_probes++;
+    while (cg->slots[i] != -1 && cg->vars[cg->slots[i]].sym != sym) {
+        i = (i + 1) & cg->slot_mask;
+        cg->var_probes++;
+    }
+    return i;
+}
+
+// streaming mode: variables used before their declaration get declared
+// on first use instead of failing, since later statements are not seen yet
+void set_implicit_declarations(CodeGenState *cg, int enable) {
+    cg->implicit_decls = enable;
+}
+
+// clean up each statement's instructions before they are printed
+void set_peephole(CodeGenState *cg, int enable) {
+    cg->peephole = enable;
+}
+
+// keep the whole program's instructions until the end, then give
+// variables whose lifetimes never overlap the same address; variables
+// get provisional addresses until then, so the memory limit is checked
+// only after packing
+void set_slot_packing(CodeGenState *cg, int enable) {
+    cg->pack_slots = enable;
+}
+
+// also encode the generated code into img as machine code
+void set_machine_image(CodeGenState *cg, MachineImage *img) {
+    cg->image = img;
+}
+
+// lower a whole program's top-level statements on jobs threads; the
+// output does not change
+void set_codegen_jobs(CodeGenState *cg, int jobs) {
+    cg->jobs = jobs > 1 ? jobs : 1;
+}
+
+// mem_size is the target's data memory (addresses 0..mem_size-1)
+void init_codegen(CodeGenState *cg, int mem_size, const Interner *names,
+                  OutputSink *out, ErrorHandler *err) {
+    cg->var_idx = 0;
+    cg->next_addr = DATA_BASE_ADDR;
+    cg->mem_size = mem_size;
+    cg->label_num = 0;
+    cg->implicit_decls = 0;
+    cg->peephole = 0;
+    cg->pack_slots = 0;
+    cg->hold_code = 0;
+    cg->jobs = 1;
+    cg->slots_before = 0;
+    cg->slots_after = 0;
+    cg->temps = 0;
+    cg->image = NULL;
+    cg->instructions = 0;
+    cg->var_lookups = 0;
+    cg->var_probes = 0;
+    cg->blocks = NULL;
+    cg->block_cap = 0;
+    cg->exprs = NULL;
+    cg->expr_cap = 0;
+    cg->expr_need = NULL;
+    cg->need_cap = 0;
+    init_ir(&cg->ir);
+    cg->ir_grows = 0;
+    cg->ir_optimized = 0;
+    init_peephole(&cg->peep);
+    cg->names = names;
+    cg->out = out;
+    cg->err = err;
+
+    // size table for every address the target can hold
+    int capacity = cg->mem_size - DATA_BASE_ADDR;
+    if (capacity < 1) {
+        capacity = 1;
+    }
+    cg->var_cap = capacity;
+    cg->vars = (Variable*)cg_alloc(sizeof(Variable) * cg->var_cap);
+    alloc_slots(cg, capacity);
+}
+
+void cleanup_codegen(CodeGenState *cg) {
+    free(cg->vars);
+    free(cg->slots);
+    cg->ir_grows += cg->ir.grows;
+    free_ir(&cg->ir);
+    free(cg->blocks);
+    free(cg->exprs);
+    free(cg->expr_need);
+    cg->blocks = NULL;
+    cg->exprs = NULL;
+    cg->expr_need = NULL;
+    cg->block_cap = 0;
+    cg->expr_cap = 0;
+    cg->need_cap = 0;
+    cg->vars = NULL;
+    cg->slots = NULL;
+    cg->var_idx = 0;
+}
+
+// add variable to symbol table
+int add_variable(CodeGenState *cg, int sym) {
+    // check if already exists
+    int i = find_slot(cg, sym);
+    if (cg->slots[i] != -1) {
+        return cg->vars[cg->slots[i]].addr;
+    }
+    
+    // spill slots already handed out stay at the top
+    if (cg->next_addr >= cg->mem_size - cg->temps && !cg->pack_slots) {
+        raise_error(cg->err, "Out of data memory: variable '%s' does not fit below address %d",
+                    symbol_name(cg->names, sym), cg->mem_size - cg->temps);
+    }
+    
+    if (cg->var_idx == cg->var_cap) {
+        cg->var_cap *= 2;
+        Variable *grown = (Variable*)realloc(cg->vars, sizeof(Variable) * cg->var_cap);
+        if (!grown) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        cg->vars = grown;
+    }
+    
+    cg->vars[cg->var_idx].sym = sym;
+    cg->vars[cg->var_idx].addr = cg->next_addr++;
+    cg->slots[i] = cg->var_idx;
+    
+    int addr = cg->vars[cg->var_idx++].addr;
+    
+    // keep load factor under 1/2
+    if (cg->var_idx * 2 > cg->slot_mask + 1) {
+        grow_slots(cg);
+    }
+    return addr;
+}
+
+// address of sym, or -1 if it has not been declared
+int find_variable(CodeGenState *cg, int sym) {
+    int i = find_slot(cg, sym);
+    return cg->slots[i] != -1 ? cg->vars[cg->slots[i]].addr : -1;
+}
+
+// get variable address
+int get_variable_address(CodeGenState *cg, int sym) {
+    int i = find_slot(cg, sym);
+    if (cg->slots[i] != -1) {
+        return cg->vars[cg->slots[i]].addr;
+    }
+    if (cg->implicit_decls) {
+        return add_variable(cg, sym);
+    }
+    raise_error(cg->err, "Variable '%s' not found", symbol_name(cg->names, sym));
+    return 0;
+}
+
+// collect all declarations first, in source order. Nodes are stored in
+// post-order, so root's subtree is one run of the pool with its
+// statements in source order, and a linear scan over the kinds finds
+// every declaration and assignment (expressions cannot declare)
+void collect_declarations(CodeGenState *cg, const AST *t, NodeId root) {
+    if (root == AST_NONE) return;
+    
+    for (NodeId n = ast_subtree_start(t, root); n <= root; n++) {
+        // assignments declare implicitly
+        if (t->kind[n] == AST_DECLARATION || t->kind[n] == AST_ASSIGNMENT) {
+            add_variable(cg, AST_SYM(t, n));
+        }
+    }
+}
+
+// append one instruction to the current statement's code
+static IRInstr* emit_op(CodeGenState *cg, IROpcode op, char reg, int value) {
+    IRInstr *in = ir_append(&cg->ir, op);
+    in->reg = reg;
+    in->value = value;
+    return in;
+}
+
+// comment line, fmt may take the name of sym (-1 for none)
+static void emit_comment(CodeGenState *cg, const char *fmt, int sym) {
+    IRInstr *in = ir_append(&cg->ir, IR_COMMENT);
+    in->text = fmt;
+    in->value = sym;
+}
+
+// label definition or jump to prefix_num
+static void emit_label_op(CodeGenState *cg, IROpcode op, const char *prefix, int num) {
+    IRInstr *in = ir_append(&cg->ir, op);
+    in->text = prefix;
+    in->value = num;
+}
+
+// load a number or variable into reg
+static void gen_leaf(CodeGenState *cg, const AST *t, NodeId leaf, char reg) {
+    if (t->kind[leaf] == AST_NUMBER) {
+        emit_op(cg, IR_LDI, reg, AST_INT(t, leaf));
+    } else if (t->kind[leaf] == AST_IDENTIFIER) {
+        emit_op(cg, IR_LOAD, reg, get_variable_address(cg, AST_SYM(t, leaf)));
+    } else {
+        raise_error(cg->err, "Unsupported operand in expression");
+    }
+}
+
+// grow a work stack array of elem-sized entries to hold one more
+static void* grow_frames(void *frames, int *cap, int used, size_t elem) {
+    if (used < *cap) {
+        return frames;
+    }
+    *cap = *cap ? *cap * 2 : 64;
+    void *grown = realloc(frames, elem * *cap);
+    if (!grown) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    return grown;
+}
+
+// data address of spill slot k. Slots sit at the top of data memory,
+// below mem_size, so variables declared after them (streaming) never
+// land on one; with slot packing every variable is known by now and they
+// follow the variables until pack_variables moves them after the slots
+static int temp_address(CodeGenState *cg, int k) {
+    if (k + 1 > cg->temps) {
+        cg->temps = k + 1;
+    }
+    if (cg->pack_slots) {
+        return DATA_BASE_ADDR + cg->var_idx + k;
+    }
+    int addr = cg->mem_size - 1 - k;
+    if (addr < cg->next_addr) {
+        raise_error(cg->err, "Out of data memory: expression temporaries do not fit below address %d",
+                    cg->mem_size);
+    }
+    return addr;
+}
+
+// Sethi-Ullman labels: spill slots each node of expr's subtree needs to
+// be evaluated into A, in cg->expr_need from the subtree's first node.
+// Every operator needs both registers, so an operator with two operator
+// operands parks one of them in memory; the operand needing more slots
+// goes first, the other is then evaluated with one slot held. Children
+// come before their parent in the pool, so one forward pass does it.
+static void label_expr(CodeGenState *cg, const AST *t, NodeId start, NodeId expr) {
+    int count = expr - start + 1;
+    if (count > cg->need_cap) {
+        cg->need_cap = count;
+        cg->expr_need = (int*)realloc(cg->expr_need, sizeof(int) * cg->need_cap);
+        if (!cg->expr_need) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+    }
+    for (NodeId n = start; n <= expr; n++) {
+        int need = 0;
+        if (t->kind[n] == AST_BINARY_OP) {
+            NodeId l = AST_LEFT(t, n);
+            NodeId r = AST_RIGHT(t, n);
+            for (int i = 0; i < 2; i++) {
+                NodeId side = i ? r : l;
+                if (t->kind[side] == AST_BINARY_OP && t->op[side] == OP_EQUAL) {
+                    raise_error(cg->err, "Unsupported operand: comparison inside an expression");
+                }
+            }
+            int nl = cg->expr_need[l - start];
+            int nr = cg->expr_need[r - start];
+            if (t->kind[l] == AST_BINARY_OP && t->kind[r] == AST_BINARY_OP && nl == nr) {
+                need = nl + 1;
+            } else {
+                need = nl > nr ? nl : nr;
+            }
+        } else if (t->kind[n] != AST_NUMBER && t->kind[n] != AST_IDENTIFIER) {
+            raise_error(cg->err, "Unsupported operand in expression");
+        }
+        cg->expr_need[n - start] = need;
+    }
+}
+
+// operand of n evaluated first: an operator before a leaf (the leaf then
+// goes straight into B), of two operators the one needing more slots
+static NodeId first_operand(const CodeGenState *cg, const AST *t, NodeId start, NodeId n) {
+    NodeId l = AST_LEFT(t, n);
+    NodeId r = AST_RIGHT(t, n);
+    if (t->kind[r] != AST_BINARY_OP) {
+        return l;
+    }
+    if (t->kind[l] != AST_BINARY_OP) {
+        return r;
+    }
+    return cg->expr_need[l - start] > cg->expr_need[r - start] ? l : r;
+}
+
+static int push_expr(CodeGenState *cg, int top, NodeId n, int slot) {
+    cg->exprs = (ExprFrame*)grow_frames(cg->exprs, &cg->expr_cap, top, sizeof(ExprFrame));
+    cg->exprs[top].node = n;
+    cg->exprs[top].step = 0;
+    cg->exprs[top].slot = slot;
+    return top + 1;
+}
+
+// apply n once one operand is in A; the other is a leaf, or the first
+// operand waiting in spill slot `slot`. The machine computes A op B, so
+// the operand in B must be the right one unless op commutes.
+static void finish_op(CodeGenState *cg, const AST *t, NodeId n, NodeId in_a, NodeId other, int slot) {
+    int spilled = t->kind[other] == AST_BINARY_OP;
+    if (t->op[n] == OP_SUB && in_a == AST_RIGHT(t, n)) {
+        emit_op(cg, IR_MOV, 'B', 0)->src = 'A';
+        if (spilled) {
+            emit_op(cg, IR_LOAD, 'A', temp_address(cg, slot));
+        } else {
+            gen_leaf(cg, t, other, 'A');
+        }
+    } else if (spilled) {
+        emit_op(cg, IR_LOAD, 'B', temp_address(cg, slot));
+    } else {
+        gen_leaf(cg, t, other, 'B');
+    }
+    ir_append(&cg->ir, t->op[n] == OP_ADD ? IR_ADD : t->op[n] == OP_SUB ? IR_SUB : IR_CMP);
+}
+
+// generate code for expressions, leaving the value in A; returns 1 for
+// a comparison. Operands are evaluated in Sethi-Ullman order with spill
+// slots where both are operators, so any tree compiles with one store
+// and one load per such operator and no other memory traffic.
+int gen_expr_code(CodeGenState *cg, const AST *t, NodeId expr) {
+    if (expr == AST_NONE) return 0;
+    
+    NodeId start = ast_subtree_start(t, expr);
+    label_expr(cg, t, start, expr);
+    
+    // step 0: nothing done, 1: first operand in A, 2: second operand in
+    // A with the first in the frame's slot
+    int top = push_expr(cg, 0, expr, 0);
+    while (top > 0) {
+        ExprFrame *f = &cg->exprs[top - 1];
+        NodeId n = f->node;
+        if (t->kind[n] != AST_BINARY_OP) {
+            gen_leaf(cg, t, n, 'A');
+            top--;
+            continue;
+        }
+        NodeId first = first_operand(cg, t, start, n);
+        NodeId second = first == AST_LEFT(t, n) ? AST_RIGHT(t, n) : AST_LEFT(t, n);
+        if (f->step == 0) {
+            f->step = 1;
+            top = push_expr(cg, top, first, f->slot);
+        } else if (f->step == 1 && t->kind[second] == AST_BINARY_OP) {
+            int slot = f->slot;
+            f->step = 2;
+            emit_op(cg, IR_STORE, 'A', temp_address(cg, slot));
+            top = push_expr(cg, top, second, slot + 1);
+        } else if (f->step == 1) {
+            finish_op(cg, t, n, first, second, f->slot);
+            top--;
+        } else {
+            finish_op(cg, t, n, second, first, f->slot);
+            top--;
+        }
+    }
+    return t->kind[expr] == AST_BINARY_OP && t->op[expr] == OP_EQUAL;
+}
+
+// print (and encode) the buffered instructions, then empty the buffer
+static void output_code(CodeGenState *cg) {
+    for (int i = 0; i < cg->ir.count; i++) {
+        if (cg->ir.code[i].op != IR_COMMENT && cg->ir.code[i].op != IR_LABEL) {
+            cg->instructions++;
+        }
+    }
+    if (cg->image) {
+        encode_ir(cg->image, &cg->ir);
+    }
+    print_ir(&cg->ir, cg->names, cg->out);
+    cg->ir.count = 0;
+    cg->ir_optimized = 0;
+}
+
+// optimize and print the buffered instructions; with slot packing they
+// are held back until gen_program_end, with hold_code for the caller
+void flush_code(CodeGenState *cg) {
+    if (cg->peephole) {
+        IRBuffer tail;
+        tail.code = cg->ir.code + cg->ir_optimized;
+        tail.count = cg->ir.count - cg->ir_optimized;
+        tail.cap = tail.count;
+        run_peephole(&cg->peep, &tail);
+        cg->ir.count = cg->ir_optimized + tail.count;
+    }
+    cg->ir_optimized = cg->ir.count;
+    if (!cg->pack_slots && !cg->hold_code) {
+        output_code(cg);
+    }
+}
+
+// move every variable to its packed slot and rewrite memory operands
+static void pack_variables(CodeGenState *cg) {
+    int count = cg->var_idx;
+    int *addr_of = (int*)cg_alloc(sizeof(int) * (count > 0 ? count : 1));
+    cg->slots_before = count;
+    cg->slots_after = pack_data_slots(&cg->ir, DATA_BASE_ADDR, count, addr_of);
+    if (DATA_BASE_ADDR + cg->slots_after + cg->temps > cg->mem_size) {
+        free(addr_of);
+        raise_error(cg->err, "Out of data memory: %d slots needed after packing, %d available",
+                    cg->slots_after + cg->temps, cg->mem_size - DATA_BASE_ADDR);
+    }
+    
+    // spill slots follow the variables and go after the packed slots
+    for (int i = 0; i < cg->ir.count; i++) {
+        IRInstr *in = &cg->ir.code[i];
+        if (in->op == IR_LOAD || in->op == IR_STORE) {
+            int v = in->value - DATA_BASE_ADDR;
+            in->value = v < count ? addr_of[v] : DATA_BASE_ADDR + cg->slots_after + (v - count);
+        }
+    }
+    for (int v = 0; v < count; v++) {
+        cg->vars[v].addr = addr_of[v];
+    }
+    free(addr_of);
+}
+
+// start of program text
+void gen_program_start(CodeGenState *cg) {
+    emit(cg, ".text\n");
+}
+
+// data section and final halt, after the last statement
+void gen_program_end(CodeGenState *cg) {
+    flush_code(cg);
+    if (cg->pack_slots) {
+        pack_variables(cg);
+        output_code(cg);
+    }
+    emit(cg, "\n.data\n");
+    for (int i = 0; i < cg->var_idx; i++) {
+        emit(cg, "%s_addr = %d\n", symbol_name(cg->names, cg->vars[i].sym), cg->vars[i].addr);
+    }
+    emit(cg, "hlt\n");
+    if (cg->image) {
+        finish_image(cg->image, cg->err);
+    }
+}
+
+// generate one statement; if blocks are walked with an explicit stack
+// of open blocks, their statements go inline
+static void gen_statement(CodeGenState *cg, const AST *t, NodeId node) {
+    int top = 0;
+    for (;;) {
+        switch (t->kind[node]) {
+            case AST_DECLARATION:
+                // declarations handled in collect_declarations
+                break;
+                
+            case AST_ASSIGNMENT:
+                emit_comment(cg, "; %s = ...\n", AST_SYM(t, node));
+                gen_expr_code(cg, t, AST_EXPR(t, node));
+                int addr = get_variable_address(cg, AST_SYM(t, node));
+                emit_op(cg, IR_STORE, 'A', addr);
+                break;
+                
+            case AST_CONDITIONAL:
+                {
+                    emit_comment(cg, "; if (condition) {\n", -1);
+                    
+                    gen_expr_code(cg, t, AST_COND(t, node));
+                    
+                    int else_lbl = cg->label_num++;
+                    int end_lbl = cg->label_num++;
+                    
+                    emit_label_op(cg, IR_JNZ, "else", else_lbl);
+                    
+                    cg->blocks = (BlockFrame*)grow_frames(cg->blocks, &cg->block_cap, top, sizeof(BlockFrame));
+                    cg->blocks[top].block = AST_BLOCK(t, node);
+                    cg->blocks[top].next = 0;
+                    cg->blocks[top].else_lbl = else_lbl;
+                    cg->blocks[top].end_lbl = end_lbl;
+                    top++;
+                }
+                break;
+                
+            default:
+                raise_error(cg->err, "Unknown node type for code generation");
+        }
+        
+        // next statement of the innermost open block, closing finished ones
+        node = AST_NONE;
+        while (top > 0) {
+            BlockFrame *f = &cg->blocks[top - 1];
+            if (f->next < AST_COUNT(t, f->block)) {
+                node = AST_STMTS(t, f->block)[f->next++];
+                break;
+            }
+            emit_label_op(cg, IR_JMP, "end", f->end_lbl);
+            emit_label_op(cg, IR_LABEL, "else", f->else_lbl);
+            emit_label_op(cg, IR_LABEL, "end", f->end_lbl);
+            top--;
+        }
+        if (node == AST_NONE) {
+            return;
+        }
+    }
+}
+
+// generate assembly code; each top-level statement (depth 0) is
+// buffered, optimized and printed on its own
+void generate_code(CodeGenState *cg, const AST *t, NodeId node, int depth) {
+    if (node == AST_NONE) return;
+    
+    if (t->kind[node] == AST_PROGRAM && cg->jobs > 1) {
+        generate_parallel(cg, t, node);
+        return;
+    }
+    if (t->kind[node] == AST_PROGRAM) {
+        gen_program_start(cg);
+        for (int i = 0; i < AST_COUNT(t, node); i++) {
+            generate_code(cg, t, AST_STMTS(t, node)[i], depth);
+        }
+        gen_program_end(cg);
+        return;
+    }
+    
+    gen_statement(cg, t, node);
+    if (depth == 0) {
+        flush_code(cg);
+    }
+}
+
 #endif
\ No newline at end of file
@@ -1,16 +1,93 @@
-#ifndef CODEGEN_H
-#define CODEGEN_H
-
-#include "parser.h"
-
-// Function declarations for code generator
-
-void init_codegen(void);
-void cleanup_codegen(void);
-int add_variable(char* name);
-int get_variable_address(char* name);
-void collect_declarations(ASTNode* node);
-int generate_expression_code(ASTNode* node);
-void generate_code(ASTNode* node, int depth);
-
-#endif // CODEGEN_H
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include "parser.h"
+#include "intern.h"
+#include "output.h"
+#include "error.h"
+#include "ir.h"
+#include "peephole.h"
+#include "binary.h"
+
+// 8-bit CPU: 256 bytes of addressable data memory
+#define DEFAULT_DATA_MEM_SIZE 256
+
+// variable tracking
+typedef struct var_entry {
+    int sym;
+    int addr;
+} Variable;
+
+// if block being generated: statements left and the labels closing it
+typedef struct {
+    NodeId block;
+    int next;
+    int else_lbl;
+    int end_lbl;
+} BlockFrame;
+
+// expression node whose operands are still being generated
+typedef struct {
+    NodeId node;
+    int step;               // operands done so far (gen_expr_code)
+    int slot;               // first spill slot free for its operands
+} ExprFrame;
+
+typedef struct cg_state_type {
+    Variable *vars;         // declaration order, used for .data listing
+    int var_idx;
+    int var_cap;
+    int *slots;             // open addressing table of vars indices, -1 = empty
+    int slot_mask;
+    int next_addr;
+    int mem_size;           // addressable data memory of the target
+    int label_num;
+    int implicit_decls;
+    int peephole;           // run the peephole optimizer before printing
+    int pack_slots;         // share data slots between variables with disjoint lifetimes
+    int hold_code;          // flush_code keeps the code in ir instead of printing it
+    int jobs;               // threads generating top-level statements (parallel.c)
+    int slots_before;       // data slots without and with packing
+    int slots_after;
+    int temps;              // spill slots for expression temporaries used so far
+    IRBuffer ir;            // instructions not yet printed
+    size_t ir_grows;        // reallocations of instruction buffers already freed
+    int ir_optimized;       // prefix of ir already through the peephole pass
+    Peephole peep;
+    MachineImage *image;    // machine code output, NULL = assembly text only
+    size_t instructions;    // instructions emitted, after the peephole pass
+    unsigned long long var_lookups;     // variable table lookups and slots examined
+    unsigned long long var_probes;
+    // work stacks of the tree walks, kept between statements
+    BlockFrame *blocks;
+    int block_cap;
+    ExprFrame *exprs;
+    int expr_cap;
+    int *expr_need;         // spill slots per node of the expression being labeled
+    int need_cap;
+    const Interner *names;
+    OutputSink *out;
+    ErrorHandler *err;
+} CodeGenState;
+
+// Function declarations for code generator
+
+void init_codegen(CodeGenState *cg, int mem_size, const Interner *names,
+                  OutputSink *out, ErrorHandler *err);
+void set_implicit_declarations(CodeGenState *cg, int enable);
+void set_peephole(CodeGenState *cg, int enable);
+void set_slot_packing(CodeGenState *cg, int enable);
+void set_machine_image(CodeGenState *cg, MachineImage *img);
+void set_codegen_jobs(CodeGenState *cg, int jobs);
+void cleanup_codegen(CodeGenState *cg);
+int add_variable(CodeGenState *cg, int sym);
+int find_variable(CodeGenState *cg, int sym);
+int get_variable_address(CodeGenState *cg, int sym);
+void collect_declarations(CodeGenState *cg, const AST *t, NodeId root);
+int gen_expr_code(CodeGenState *cg, const AST *t, NodeId expr);
+void flush_code(CodeGenState *cg);
+void gen_program_start(CodeGenState *cg);
+void gen_program_end(CodeGenState *cg);
+void generate_code(CodeGenState *cg, const AST *t, NodeId node, int depth);
+
+#endif // CODEGEN_H
\ No newline at end of file
@@ -0,0 +1,139 @@
+// Reentrant compiler context and compile-from-buffer API
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compiler.h"
+
+void compiler_init(Compiler *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->options.mem_size = DEFAULT_DATA_MEM_SIZE;
+    ctx->options.opt_level = DEFAULT_OPT_LEVEL;
+    init_interner(&ctx->names);
+    init_ast(&ctx->ast);
+    init_token_array(&ctx->tokens);
+    init_error_handler(&ctx->err);
+    init_parser(&ctx->parser, &ctx->ast, &ctx->names, &ctx->err);
+    init_optimizer(&ctx->opt);
+}
+
+void compiler_free(Compiler *ctx) {
+    cleanup_parser(&ctx->parser);
+    cleanup_optimizer(&ctx->opt);
+    free_ast(&ctx->ast);
+    free_token_array(&ctx->tokens);
+    free_interner(&ctx->names);
+}
+
+// variables share data slots only at -O2, and not when each statement
+// must lower on its own for an incremental index
+int compiler_packs_slots(const CompileOptions *opts) {
+    return opts->opt_level >= 2 && !opts->incremental;
+}
+
+static void begin_phase(Compiler *ctx, const CompileHooks *hooks, CompilePhase phase, NodeId root) {
+    if (hooks && hooks->begin_phase) {
+        hooks->begin_phase(hooks->user, ctx, phase, root);
+    }
+}
+
+static void end_phase(Compiler *ctx, const CompileHooks *hooks, CompilePhase phase) {
+    if (hooks && hooks->end_phase) {
+        hooks->end_phase(hooks->user, ctx, phase);
+    }
+}
+
+// run one compilation; errors unwind here and return 1. Phase hooks
+// only see whole-buffer compilations, streaming interleaves the phases
+static int run_compile(Compiler *ctx, SourceBuffer *src, OutputSink *out, int streaming,
+                       const CompileHooks *hooks) {
+    ast_reset(&ctx->ast);
+    parser_set_input(&ctx->parser, src);
+    if (!streaming && ctx->lex_jobs > 1) {
+        // lexing is a phase of its own, the parser reads its tokens
+        begin_phase(ctx, hooks, PHASE_LEX, AST_NONE);
+        lex_parallel(&ctx->tokens, src->data, src->len, &ctx->names, ctx->lex_jobs);
+        parser_set_tokens(&ctx->parser, &ctx->tokens);
+        end_phase(ctx, hooks, PHASE_LEX);
+    }
+    init_codegen(&ctx->cg, ctx->options.mem_size, &ctx->names, out, &ctx->err);
+    reset_optimizer(&ctx->opt);
+    int optimize = ctx->options.opt_level >= 1;
+    set_peephole(&ctx->cg, optimize);
+    set_slot_packing(&ctx->cg, !streaming && compiler_packs_slots(&ctx->options));
+    set_codegen_jobs(&ctx->cg, ctx->codegen_jobs);
+    ctx->err.msg[0] = '\0';
+
+    if (setjmp(ctx->err.env) != 0) {
+        ctx->err.active = 0;
+        cleanup_codegen(&ctx->cg);
+        return 1;
+    }
+    ctx->err.active = 1;
+
+    if (streaming) {
+        // parse, lower, emit and free one top-level statement at a time
+        set_implicit_declarations(&ctx->cg, 1);
+        gen_program_start(&ctx->cg);
+        NodeId stmt;
+        while ((stmt = parse_next_statement(&ctx->parser)) != AST_NONE) {
+            collect_declarations(&ctx->cg, &ctx->ast, stmt);
+            if (optimize) {
+                optimize_program(&ctx->opt, &ctx->ast, stmt);
+            }
+            generate_code(&ctx->cg, &ctx->ast, stmt, 0);
+            ast_reset(&ctx->ast);
+        }
+        gen_program_end(&ctx->cg);
+    } else {
+        begin_phase(ctx, hooks, PHASE_PARSE, AST_NONE);
+        NodeId root = parse_program(&ctx->parser);
+        end_phase(ctx, hooks, PHASE_PARSE);
+
+        begin_phase(ctx, hooks, PHASE_COLLECT, root);
+        collect_declarations(&ctx->cg, &ctx->ast, root);
+        end_phase(ctx, hooks, PHASE_COLLECT);
+
+        if (optimize) {
+            begin_phase(ctx, hooks, PHASE_OPTIMIZE, root);
+            optimize_program(&ctx->opt, &ctx->ast, root);
+            end_phase(ctx, hooks, PHASE_OPTIMIZE);
+        }
+
+        begin_phase(ctx, hooks, PHASE_CODEGEN, root);
+        if (hooks && hooks->generate) {
+            hooks->generate(hooks->user, ctx, root);
+        } else {
+            generate_code(&ctx->cg, &ctx->ast, root, 0);
+        }
+        end_phase(ctx, hooks, PHASE_CODEGEN);
+    }
+
+    ctx->err.active = 0;
+    cleanup_codegen(&ctx->cg);
+    return 0;
+}
+
+// compile src[0..len) and write assembly to out; 0 on success
+int compile_buffer(Compiler *ctx, const char *src, size_t len, OutputSink *out) {
+    SourceBuffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.data = src;
+    buf.len = len;
+    buf.eof = 1;
+    return compile_source(ctx, &buf, out, NULL);
+}
+
+// compile a streamed source in constant memory; 0 on success
+int compile_stream(Compiler *ctx, SourceBuffer *src, OutputSink *out) {
+    return run_compile(ctx, src, out, 1, NULL);
+}
+
+// compile a whole source buffer, calling hooks around each phase; 0 on success
+int compile_source(Compiler *ctx, SourceBuffer *src, OutputSink *out, const CompileHooks *hooks) {
+    return run_compile(ctx, src, out, 0, hooks);
+}
+
+// message of the last failed compilation
+const char* compiler_error(const Compiler *ctx) {
+    return ctx->err.msg;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stddef.h>
+#include "source.h"
+#include "intern.h"
+#include "ast.h"
+#include "parser.h"
+#include "tokens.h"
+#include "codegen.h"
+#include "optimize.h"
+#include "output.h"
+#include "error.h"
+
+// bumped whenever generated code may change (part of cache keys)
+#define COMPILER_VERSION "1.4"
+
+#define DEFAULT_OPT_LEVEL 1
+
+// Options that affect generated code
+typedef struct {
+    int mem_size;       // target data memory size in bytes
+    int opt_level;      // 0 = none, 1 = constant folding and peephole,
+                        // 2 = also pack variables into shared data slots
+    int incremental;    // statements lowered on their own for an incremental
+                        // index, which rules out slot packing
+} CompileOptions;
+
+// Phases of one compilation, in order
+typedef enum {
+    PHASE_LEX,          // parallel lexing of the whole buffer, or a separate
+                        // lexing-only pass for stats; parse includes its own lexing
+    PHASE_PARSE,
+    PHASE_COLLECT,
+    PHASE_OPTIMIZE,
+    PHASE_CODEGEN,
+    PHASE_COUNT
+} CompilePhase;
+
+// All state of one compiler instance. Separate contexts share nothing,
+// so different threads can compile at the same time. The interner and
+// AST node pool stay warm between compilations on the same context.
+typedef struct {
+    CompileOptions options;
+    int codegen_jobs;   // threads for code generation, output is the same for any count
+    int lex_jobs;       // threads lexing a whole buffer before parsing, 1 to lex while parsing
+    Interner names;
+    AST ast;
+    TokenArray tokens;
+    Parser parser;
+    CodeGenState cg;
+    Optimizer opt;
+    ErrorHandler err;
+} Compiler;
+
+// Optional callbacks into compile_source, any of them may be NULL. Errors
+// raised from a callback fail the compilation like any other.
+typedef struct {
+    void *user;
+    void (*begin_phase)(void *user, Compiler *ctx, CompilePhase phase, NodeId root);
+    void (*end_phase)(void *user, Compiler *ctx, CompilePhase phase);
+    // lowers root in place of generate_code, while codegen state is live
+    void (*generate)(void *user, Compiler *ctx, NodeId root);
+} CompileHooks;
+
+// Function declarations
+void compiler_init(Compiler *ctx);
+void compiler_free(Compiler *ctx);
+int compile_buffer(Compiler *ctx, const char *src, size_t len, OutputSink *out);
+int compile_stream(Compiler *ctx, SourceBuffer *src, OutputSink *out);
+int compile_source(Compiler *ctx, SourceBuffer *src, OutputSink *out, const CompileHooks *hooks);
+int compiler_packs_slots(const CompileOptions *opts);
+const char* compiler_error(const Compiler *ctx);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+// Compile error reporting
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "error.h"
+
+void init_error_handler(ErrorHandler *eh) {
+    eh->active = 0;
+    eh->msg[0] = '\0';
+}
+
+// record error message, then unwind to the caller or exit
+void raise_error(ErrorHandler *eh, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(eh->msg, sizeof(eh->msg), fmt, ap);
+    va_end(ap);
+
+    if (eh->active) {
+        longjmp(eh->env, 1);
+    }
+    printf("%s\n", eh->msg);
+    exit(1);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef ERROR_H
+#define ERROR_H
+
+#include <setjmp.h>
+
+// Compile error reporting: the command line tool prints and exits,
+// library callers arm the handler and get control back via longjmp
+typedef struct {
+    jmp_buf env;
+    int active;         // 1 = longjmp to env, 0 = print and exit(1)
+    char msg[256];
+} ErrorHandler;
+
+// Function declarations
+void init_error_handler(ErrorHandler *eh);
+void raise_error(ErrorHandler *eh, const char *fmt, ...);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,431 @@
+// Incremental recompilation at top-level statement granularity
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "incremental.h"
+#include "sha256.h"
+
+#define INDEX_MAGIC "simplelang-index 3"
+
+static void* inc_realloc(void *p, size_t size) {
+    void *grown = realloc(p, size);
+    if (!grown) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    return grown;
+}
+
+void init_incremental_index(IncrementalIndex *idx) {
+    memset(idx, 0, sizeof(*idx));
+}
+
+void free_incremental_index(IncrementalIndex *idx) {
+    free(idx->stmts);
+    free(idx->addrs);
+    free(idx->slots);
+    free_string_buffer(&idx->text);
+    init_incremental_index(idx);
+}
+
+static void push_addr(IncrementalIndex *idx, int addr) {
+    if (idx->addr_count == idx->addr_cap) {
+        idx->addr_cap = idx->addr_cap ? idx->addr_cap * 2 : 256;
+        idx->addrs = (int*)inc_realloc(idx->addrs, sizeof(int) * idx->addr_cap);
+    }
+    idx->addrs[idx->addr_count++] = addr;
+}
+
+static StmtRecord* push_record(IncrementalIndex *idx) {
+    if (idx->count == idx->cap) {
+        idx->cap = idx->cap ? idx->cap * 2 : 64;
+        idx->stmts = (StmtRecord*)inc_realloc(idx->stmts, sizeof(StmtRecord) * idx->cap);
+    }
+    return &idx->stmts[idx->count++];
+}
+
+static size_t fp_slot(const IncrementalIndex *idx, const unsigned char fp[16]) {
+    size_t h;
+    memcpy(&h, fp, sizeof(h));
+    return h & idx->slot_mask;
+}
+
+// fingerprint table over all records, duplicates allowed
+static void build_slots(IncrementalIndex *idx) {
+    size_t size = 16;
+    while (size < (size_t)idx->count * 2) {
+        size *= 2;
+    }
+    idx->slots = (int*)inc_realloc(NULL, sizeof(int) * size);
+    for (size_t i = 0; i < size; i++) {
+        idx->slots[i] = -1;
+    }
+    idx->slot_mask = size - 1;
+    for (int r = 0; r < idx->count; r++) {
+        size_t i = fp_slot(idx, idx->stmts[r].fp);
+        while (idx->slots[i] != -1) {
+            i = (i + 1) & idx->slot_mask;
+        }
+        idx->slots[i] = r;
+    }
+}
+
+static void hash_int(OutputSink *h, int v) {
+    sink_write(h, (const char*)&v, sizeof(v));
+}
+
+static void hash_symbol(OutputSink *h, const Interner *names, int sym) {
+    const char *name = symbol_name(names, sym);
+    size_t len = strlen(name);
+    hash_int(h, (int)len);
+    sink_write(h, name, len);
+}
+
+// serialize the statement structure by symbol name (IDs differ between
+// runs) for hashing, and record the address of every variable it
+// touches; *missing is set when one is undeclared so the statement gets
+// lowered for the error, or when it needs spill slots, which must be
+// checked against this program's variables. Nodes are visited in
+// preorder from the todo stack, children pushed in reverse.
+static void fingerprint_node(CodeGenState *cg, const AST *t, NodeId root, OutputSink *h,
+                             IncrementalIndex *idx, int *missing, ASTStack *todo) {
+    todo->top = 0;
+    ast_stack_push(todo, root);
+    
+    while (todo->top > 0) {
+        NodeId node = todo->items[--todo->top];
+        if (node == AST_NONE) {
+            hash_int(h, -1);
+            continue;
+        }
+        hash_int(h, (int)t->kind[node]);
+        
+        int addr;
+        switch (t->kind[node]) {
+            case AST_DECLARATION:
+                hash_symbol(h, cg->names, AST_SYM(t, node));
+                break;
+            case AST_ASSIGNMENT:
+                hash_symbol(h, cg->names, AST_SYM(t, node));
+                addr = find_variable(cg, AST_SYM(t, node));
+                *missing |= addr < 0;
+                push_addr(idx, addr);
+                ast_stack_push(todo, AST_EXPR(t, node));
+                break;
+            case AST_BINARY_OP:
+                hash_int(h, (int)t->op[node]);
+                *missing |= t->kind[AST_LEFT(t, node)] == AST_BINARY_OP &&
+                            t->kind[AST_RIGHT(t, node)] == AST_BINARY_OP;
+                ast_stack_push(todo, AST_RIGHT(t, node));
+                ast_stack_push(todo, AST_LEFT(t, node));
+                break;
+            case AST_NUMBER:
+                hash_int(h, AST_INT(t, node));
+                break;
+            case AST_IDENTIFIER:
+                hash_symbol(h, cg->names, AST_SYM(t, node));
+                addr = find_variable(cg, AST_SYM(t, node));
+                *missing |= addr < 0;
+                push_addr(idx, addr);
+                break;
+            case AST_CONDITIONAL:
+                ast_stack_push(todo, AST_BLOCK(t, node));
+                ast_stack_push(todo, AST_COND(t, node));
+                break;
+            case AST_PROGRAM:
+                hash_int(h, AST_COUNT(t, node));
+                for (int i = AST_COUNT(t, node) - 1; i >= 0; i--) {
+                    ast_stack_push(todo, AST_STMTS(t, node)[i]);
+                }
+                break;
+        }
+    }
+}
+
+// a fragment is reusable if the statement is unchanged, every variable
+// kept its address, any labels it uses start at the same number and
+// the peephole pass starts from the same register contents
+static int find_reusable(const IncrementalIndex *prev, const unsigned char fp[16],
+                         const int *addrs, int addr_count, int label_num,
+                         const RegState *entry) {
+    if (!prev || !prev->slots) {
+        return -1;
+    }
+    size_t i = fp_slot(prev, fp);
+    while (prev->slots[i] != -1) {
+        const StmtRecord *r = &prev->stmts[prev->slots[i]];
+        if (memcmp(r->fp, fp, sizeof(r->fp)) == 0 && r->addr_count == addr_count &&
+            (addr_count == 0 ||
+             memcmp(prev->addrs + r->addr_start, addrs, sizeof(int) * addr_count) == 0) &&
+            (r->labels == 0 || r->label_base == label_num) &&
+            memcmp(&r->entry, entry, sizeof(*entry)) == 0) {
+            return prev->slots[i];
+        }
+        i = (i + 1) & prev->slot_mask;
+    }
+    return -1;
+}
+
+// emit the program like generate_code, splicing fragments from prev where
+// possible; every statement's fragment is recorded into next for saving
+void generate_incremental(CodeGenState *cg, const AST *t, NodeId program, IncrementalIndex *prev,
+                          IncrementalIndex *next) {
+    OutputSink *out = cg->out;
+    OutputSink capture;
+    init_string_sink(&capture, &next->text);
+    StringBuffer shape = { NULL, 0, 0 };
+    OutputSink shape_sink;
+    init_string_sink(&shape_sink, &shape);
+    ASTStack todo = { NULL, 0, 0 };
+
+    gen_program_start(cg);
+    for (int s = 0; s < AST_COUNT(t, program); s++) {
+        NodeId stmt = AST_STMTS(t, program)[s];
+        int addr_start = next->addr_count;
+        int missing = 0;
+        unsigned char digest[32];
+        Sha256 h;
+        shape.len = 0;
+        fingerprint_node(cg, t, stmt, &shape_sink, next, &missing, &todo);
+        sha256_init(&h);
+        sha256_update(&h, shape.data, shape.len);
+        sha256_final(&h, digest);
+
+        int label_base = cg->label_num;
+        RegState entry = cg->peep.state;
+        size_t text_start = next->text.len;
+        int hit = missing ? -1 : find_reusable(prev, digest, next->addrs + addr_start,
+                                               next->addr_count - addr_start, label_base,
+                                               &entry);
+        if (hit >= 0) {
+            const StmtRecord *old = &prev->stmts[hit];
+            if (old->text_len > 0) {
+                sink_write(&capture, prev->text.data + old->text_start, old->text_len);
+            }
+            cg->label_num += old->labels;
+            cg->peep.state = old->exit;
+            next->reused++;
+        } else {
+            cg->out = &capture;
+            generate_code(cg, t, stmt, 0);
+            cg->out = out;
+        }
+
+        size_t text_len = next->text.len - text_start;
+        if (text_len > 0) {
+            sink_write(out, next->text.data + text_start, text_len);
+        }
+
+        StmtRecord *r = push_record(next);
+        memcpy(r->fp, digest, sizeof(r->fp));
+        r->label_base = label_base;
+        r->labels = cg->label_num - label_base;
+        r->entry = entry;
+        r->exit = cg->peep.state;
+        r->addr_start = addr_start;
+        r->addr_count = next->addr_count - addr_start;
+        r->text_start = text_start;
+        r->text_len = text_len;
+    }
+    gen_program_end(cg);
+    free_string_buffer(&shape);
+    free_ast_stack(&todo);
+}
+
+// parse a non-negative decimal number followed by one separator
+static const char* read_number(const char *p, const char *end, long *v) {
+    if (p >= end || *p < '0' || *p > '9') {
+        return NULL;
+    }
+    *v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        *v = *v * 10 + (*p++ - '0');
+        if (*v > 0x7fffffffL) {
+            return NULL;
+        }
+    }
+    if (p >= end || (*p != ' ' && *p != '\n')) {
+        return NULL;
+    }
+    return p + 1;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// register state as six numbers, addresses offset by one so -1 fits
+static const char* read_regs(const char *p, const char *end, RegState *st) {
+    RegValue *regs[2] = { &st->a, &st->b };
+    for (int i = 0; i < 2; i++) {
+        long has_const, value, mem;
+        if (!(p = read_number(p, end, &has_const)) || !(p = read_number(p, end, &value)) ||
+            !(p = read_number(p, end, &mem))) {
+            return NULL;
+        }
+        regs[i]->has_const = (int)has_const;
+        regs[i]->value = (int)value;
+        regs[i]->mem = (int)mem - 1;
+    }
+    return p;
+}
+
+// read one record line: fingerprint, label base, labels, entry and exit
+// register state, text length, address count, addresses
+static const char* read_record(IncrementalIndex *idx, const char *p, const char *end,
+                               size_t *text_pos) {
+    if (end - p < 33 || p[32] != ' ') {
+        return NULL;
+    }
+    StmtRecord *r = push_record(idx);
+    for (int i = 0; i < 16; i++) {
+        int hi = hex_value(p[i * 2]);
+        int lo = hex_value(p[i * 2 + 1]);
+        if (hi < 0 || lo < 0) {
+            return NULL;
+        }
+        r->fp[i] = (unsigned char)(hi << 4 | lo);
+    }
+    p += 33;
+
+    long base, labels, len, n;
+    if (!(p = read_number(p, end, &base)) || !(p = read_number(p, end, &labels)) ||
+        !(p = read_regs(p, end, &r->entry)) || !(p = read_regs(p, end, &r->exit)) ||
+        !(p = read_number(p, end, &len)) || !(p = read_number(p, end, &n))) {
+        return NULL;
+    }
+    r->label_base = (int)base;
+    r->labels = (int)labels;
+    r->text_start = *text_pos;
+    r->text_len = (size_t)len;
+    r->addr_start = idx->addr_count;
+    r->addr_count = (int)n;
+    *text_pos += (size_t)len;
+    for (long i = 0; i < n; i++) {
+        long addr;
+        if (!(p = read_number(p, end, &addr))) {
+            return NULL;
+        }
+        push_addr(idx, (int)addr);
+    }
+    return p;
+}
+
+// load the index written by the previous compile; returns 0 (leaving idx
+// empty) if there is none or it was made by another version or options
+int load_incremental_index(IncrementalIndex *idx, const char *path, const CompileOptions *opts) {
+    SourceBuffer src;
+    if (!source_open(&src, path)) {
+        return 0;
+    }
+
+    char expect[128];
+    int n = snprintf(expect, sizeof(expect), "%s %s %d %d ", INDEX_MAGIC, COMPILER_VERSION,
+                     opts->mem_size, opts->opt_level);
+    const char *p = src.data;
+    const char *end = src.data + src.len;
+    long count, text_len;
+    int ok = src.len > (size_t)n && memcmp(p, expect, n) == 0 &&
+             (p = read_number(p + n, end, &count)) && (p = read_number(p, end, &text_len));
+
+    size_t text_pos = 0;
+    for (long i = 0; ok && i < count; i++) {
+        ok = (p = read_record(idx, p, end, &text_pos)) != NULL;
+    }
+    ok = ok && text_pos == (size_t)text_len && (size_t)(end - p) == text_pos;
+    if (ok && text_pos > 0) {
+        OutputSink sink;
+        init_string_sink(&sink, &idx->text);
+        sink_write(&sink, p, text_pos);
+    }
+    source_close(&src);
+
+    if (!ok) {
+        free_incremental_index(idx);
+        return 0;
+    }
+    build_slots(idx);
+    return 1;
+}
+
+static void write_number(OutputSink *sink, size_t v, char sep) {
+    char tmp[24];
+    int n = (int)sizeof(tmp);
+    tmp[--n] = sep;
+    do {
+        tmp[--n] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    sink_write(sink, tmp + n, sizeof(tmp) - n);
+}
+
+static void write_regs(OutputSink *sink, const RegState *st) {
+    const RegValue *regs[2] = { &st->a, &st->b };
+    for (int i = 0; i < 2; i++) {
+        write_number(sink, (size_t)regs[i]->has_const, ' ');
+        write_number(sink, (size_t)regs[i]->value, ' ');
+        write_number(sink, (size_t)(regs[i]->mem + 1), ' ');
+    }
+}
+
+// written next to the final path and renamed, so a crash never leaves
+// a half-written index
+int save_incremental_index(const IncrementalIndex *idx, const char *path, const CompileOptions *opts) {
+    size_t len = strlen(path);
+    char *tmp = (char*)malloc(len + 5);
+    if (!tmp) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    memcpy(tmp, path, len);
+    strcpy(tmp + len, ".tmp");
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        free(tmp);
+        return 0;
+    }
+    // records are formatted by hand, fprintf per number dominates otherwise
+    static const char digits[] = "0123456789abcdef";
+    StringBuffer buf = { NULL, 0, 0 };
+    OutputSink sink;
+    init_string_sink(&sink, &buf);
+    sink_printf(&sink, "%s %s %d %d %d %zu\n", INDEX_MAGIC, COMPILER_VERSION, opts->mem_size,
+                opts->opt_level, idx->count, idx->text.len);
+    for (int i = 0; i < idx->count; i++) {
+        const StmtRecord *r = &idx->stmts[i];
+        char line[64];
+        for (int b = 0; b < 16; b++) {
+            line[b * 2] = digits[r->fp[b] >> 4];
+            line[b * 2 + 1] = digits[r->fp[b] & 15];
+        }
+        line[32] = ' ';
+        sink_write(&sink, line, 33);
+        write_number(&sink, (size_t)r->label_base, ' ');
+        write_number(&sink, (size_t)r->labels, ' ');
+        write_regs(&sink, &r->entry);
+        write_regs(&sink, &r->exit);
+        write_number(&sink, r->text_len, ' ');
+        write_number(&sink, (size_t)r->addr_count, r->addr_count ? ' ' : '\n');
+        for (int a = 0; a < r->addr_count; a++) {
+            write_number(&sink, (size_t)idx->addrs[r->addr_start + a],
+                         a + 1 < r->addr_count ? ' ' : '\n');
+        }
+    }
+    fwrite(buf.data, 1, buf.len, f);
+    free_string_buffer(&buf);
+    if (idx->text.len > 0) {
+        fwrite(idx->text.data, 1, idx->text.len, f);
+    }
+
+    int ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok) {
+        remove(tmp);
+    }
+    free(tmp);
+    return ok;
+}
\ No newline at end of file
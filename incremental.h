@@ -0,0 +1,43 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "compiler.h"
+
+// Sidecar index for incremental recompilation: one record per top-level
+// statement with its fingerprint, the data addresses it referenced, the
+// labels it used, the peephole register state around it and its
+// emitted assembly fragment
+typedef struct {
+    unsigned char fp[16];   // truncated SHA-256 of the statement's structure
+    int label_base;         // label_num when the fragment was emitted
+    int labels;             // labels the fragment allocated
+    RegState entry;         // register contents assumed by the peephole pass
+    RegState exit;
+    int addr_start;         // first entry in addrs
+    int addr_count;
+    size_t text_start;      // fragment in text
+    size_t text_len;
+} StmtRecord;
+
+typedef struct {
+    StmtRecord *stmts;
+    int count;
+    int cap;
+    int *addrs;             // referenced addresses, in tree walk order
+    int addr_count;
+    int addr_cap;
+    StringBuffer text;      // fragments back to back
+    int *slots;             // fingerprint table of stmts indices, -1 = empty
+    size_t slot_mask;
+    int reused;             // statements spliced from the previous index
+} IncrementalIndex;
+
+// Function declarations
+void init_incremental_index(IncrementalIndex *idx);
+int load_incremental_index(IncrementalIndex *idx, const char *path, const CompileOptions *opts);
+int save_incremental_index(const IncrementalIndex *idx, const char *path, const CompileOptions *opts);
+void generate_incremental(CodeGenState *cg, const AST *t, NodeId program, IncrementalIndex *prev,
+                          IncrementalIndex *next);
+void free_incremental_index(IncrementalIndex *idx);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,133 @@
+// Identifier interning table shared by lexer, parser and codegen
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+
+#define POOL_CHUNK_SIZE (64 * 1024)
+
+static void* intern_alloc(size_t size) {
+    void *p = malloc(size);
+    if (!p) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    return p;
+}
+
+// FNV-1a hash
+static unsigned int hash_name(const char *s, size_t len) {
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// copy name into the character pool
+static const char* pool_store(Interner *it, const char *s, size_t len) {
+    if (!it->pool || it->pool->size - it->pool->used < len + 1) {
+        size_t size = len + 1 > POOL_CHUNK_SIZE ? len + 1 : POOL_CHUNK_SIZE;
+        PoolChunk *c = (PoolChunk*)intern_alloc(sizeof(PoolChunk) + size);
+        it->grows++;
+        c->next = it->pool;
+        c->used = 0;
+        c->size = size;
+        it->pool = c;
+    }
+    char *dst = it->pool->data + it->pool->used;
+    memcpy(dst, s, len);
+    dst[len] = '\0';
+    it->pool->used += len + 1;
+    return dst;
+}
+
+// rebuild slot table at double size
+static void grow_slots(Interner *it) {
+    size_t new_size = it->slots ? (it->slot_mask + 1) * 2 : 1024;
+    free(it->slots);
+    it->slots = (int*)intern_alloc(sizeof(int) * new_size);
+    it->grows++;
+    for (size_t i = 0; i < new_size; i++) {
+        it->slots[i] = -1;
+    }
+    it->slot_mask = new_size - 1;
+    for (int id = 0; id < it->sym_count; id++) {
+        size_t i = it->syms[id].hash & it->slot_mask;
+        while (it->slots[i] != -1) {
+            i = (i + 1) & it->slot_mask;
+        }
+        it->slots[i] = id;
+    }
+}
+
+void init_interner(Interner *it) {
+    memset(it, 0, sizeof(*it));
+}
+
+// get symbol ID for name, adding it if new
+int intern_symbol(Interner *it, const char *name, size_t len) {
+    if (!it->slots) {
+        grow_slots(it);
+    }
+
+    unsigned int h = hash_name(name, len);
+    size_t i = h & it->slot_mask;
+    it->lookups++;
+    it->probes++;
+    while (it->slots[i] != -1) {
+        SymbolEntry *e = &it->syms[it->slots[i]];
+        if (e->hash == h && e->len == len && memcmp(e->name, name, len) == 0) {
+            return it->slots[i];
+        }
+        i = (i + 1) & it->slot_mask;
+        it->probes++;
+    }
+
+    if (it->sym_count == it->sym_cap) {
+        it->sym_cap = it->sym_cap ? it->sym_cap * 2 : 256;
+        SymbolEntry *grown = (SymbolEntry*)realloc(it->syms, sizeof(SymbolEntry) * it->sym_cap);
+        if (!grown) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        it->syms = grown;
+        it->grows++;
+    }
+
+    int id = it->sym_count++;
+    it->syms[id].name = pool_store(it, name, len);
+    it->syms[id].len = len;
+    it->syms[id].hash = h;
+    it->slots[i] = id;
+
+    // keep load factor under 1/2
+    if ((size_t)it->sym_count * 2 > it->slot_mask + 1) {
+        grow_slots(it);
+    }
+    return id;
+}
+
+// name for symbol ID
+const char* symbol_name(const Interner *it, int sym) {
+    if (sym < 0 || sym >= it->sym_count) {
+        return "?";
+    }
+    return it->syms[sym].name;
+}
+
+int symbol_count(const Interner *it) {
+    return it->sym_count;
+}
+
+void free_interner(Interner *it) {
+    while (it->pool) {
+        PoolChunk *next = it->pool->next;
+        free(it->pool);
+        it->pool = next;
+    }
+    free(it->syms);
+    free(it->slots);
+    init_interner(it);
+}
\ No newline at end of file
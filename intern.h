@@ -0,0 +1,42 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+// Identifier interner: each distinct name gets a compact symbol ID
+// (0, 1, 2, ... in order of first appearance)
+
+typedef struct sym_entry {
+    const char *name;
+    size_t len;
+    unsigned int hash;
+} SymbolEntry;
+
+// character pool chunk holding NUL terminated names
+typedef struct pool_chunk {
+    struct pool_chunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+} PoolChunk;
+
+typedef struct {
+    SymbolEntry *syms;      // indexed by symbol ID
+    int sym_count;
+    int sym_cap;
+    int *slots;             // open addressing table of symbol IDs, -1 = empty
+    size_t slot_mask;
+    PoolChunk *pool;
+    unsigned long long lookups;     // intern_symbol calls
+    unsigned long long probes;      // table slots examined by them
+    size_t grows;                   // table, symbol array and pool chunk allocations
+} Interner;
+
+// Function declarations
+void init_interner(Interner *in);
+int intern_symbol(Interner *in, const char *name, size_t len);
+const char* symbol_name(const Interner *in, int sym);
+int symbol_count(const Interner *in);
+void free_interner(Interner *in);
+
+#endif
\ No newline at end of file
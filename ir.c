@@ -0,0 +1,89 @@
+// In-memory instruction list for generated code
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ir.h"
+
+void init_ir(IRBuffer *ir) {
+    ir->code = NULL;
+    ir->count = 0;
+    ir->cap = 0;
+    ir->grows = 0;
+}
+
+void free_ir(IRBuffer *ir) {
+    free(ir->code);
+    init_ir(ir);
+}
+
+// append a zeroed instruction and return it for the caller to fill in
+IRInstr* ir_append(IRBuffer *ir, IROpcode op) {
+    if (ir->count == ir->cap) {
+        ir->cap = ir->cap ? ir->cap * 2 : 64;
+        ir->grows++;
+        IRInstr *grown = (IRInstr*)realloc(ir->code, sizeof(IRInstr) * ir->cap);
+        if (!grown) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        ir->code = grown;
+    }
+    IRInstr *in = &ir->code[ir->count++];
+    memset(in, 0, sizeof(*in));
+    in->op = op;
+    return in;
+}
+
+// jump or label instructions naming the same label
+int ir_same_label(const IRInstr *a, const IRInstr *b) {
+    return a->value == b->value && strcmp(a->text, b->text) == 0;
+}
+
+// write one instruction in the assembler's text syntax
+void print_instr(const IRInstr *in, const Interner *names, OutputSink *out) {
+    switch (in->op) {
+        case IR_COMMENT:
+            if (in->value >= 0) {
+                sink_printf(out, in->text, symbol_name(names, in->value));
+            } else {
+                sink_printf(out, "%s", in->text);
+            }
+            break;
+        case IR_LABEL:
+            sink_printf(out, "%s_%d:\n", in->text, in->value);
+            break;
+        case IR_LDI:
+            sink_printf(out, "ldi %c %d\n", in->reg, in->value);
+            break;
+        case IR_LOAD:
+            sink_printf(out, "mov %c M %d\n", in->reg, in->value);
+            break;
+        case IR_STORE:
+            sink_printf(out, "mov M %c %d\n", in->reg, in->value);
+            break;
+        case IR_MOV:
+            sink_printf(out, "mov %c %c\n", in->reg, in->src);
+            break;
+        case IR_ADD:
+            sink_write(out, "add\n", 4);
+            break;
+        case IR_SUB:
+            sink_write(out, "sub\n", 4);
+            break;
+        case IR_CMP:
+            sink_write(out, "cmp\n", 4);
+            break;
+        case IR_JMP:
+            sink_printf(out, "jmp %s_%d\n", in->text, in->value);
+            break;
+        case IR_JNZ:
+            sink_printf(out, "jnz %s_%d\n", in->text, in->value);
+            break;
+    }
+}
+
+void print_ir(const IRBuffer *ir, const Interner *names, OutputSink *out) {
+    for (int i = 0; i < ir->count; i++) {
+        print_instr(&ir->code[i], names, out);
+    }
+}
\ No newline at end of file
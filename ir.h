@@ -0,0 +1,46 @@
+#ifndef IR_H
+#define IR_H
+
+#include "intern.h"
+#include "output.h"
+
+// Instructions of the A/B accumulator machine, held in memory between
+// lowering and printing so later passes can rewrite them
+typedef enum {
+    IR_COMMENT,     // "; ..." (text is the format, value a symbol or -1)
+    IR_LABEL,       // text_value:
+    IR_LDI,         // ldi reg value
+    IR_LOAD,        // mov reg M value
+    IR_STORE,       // mov M reg value
+    IR_MOV,         // mov reg src
+    IR_ADD,
+    IR_SUB,
+    IR_CMP,
+    IR_JMP,         // jmp text_value
+    IR_JNZ          // jnz text_value
+} IROpcode;
+
+typedef struct {
+    IROpcode op;
+    char reg;           // 'A' or 'B': destination, or source of a store
+    char src;           // source register of IR_MOV
+    int value;          // immediate, address, label number or comment symbol
+    const char *text;   // label prefix or comment format
+} IRInstr;
+
+typedef struct {
+    IRInstr *code;
+    int count;
+    int cap;
+    size_t grows;       // reallocations of code
+} IRBuffer;
+
+// Function declarations
+void init_ir(IRBuffer *ir);
+void free_ir(IRBuffer *ir);
+IRInstr* ir_append(IRBuffer *ir, IROpcode op);
+int ir_same_label(const IRInstr *a, const IRInstr *b);
+void print_instr(const IRInstr *in, const Interner *names, OutputSink *out);
+void print_ir(const IRBuffer *ir, const Interner *names, OutputSink *out);
+
+#endif
\ No newline at end of file
@@ -1,164 +1,283 @@
-// Simple lexer for SimpleLang
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <ctype.h>
-#include "lexer.h"
-
-#define MAX_TOKEN_LEN 100
-
-// Token parsing function
-int getNextToken(FILE *f, Token *t) {
-    if (f == NULL) {
-        t->type = TOKEN_EOF;
-        return 0;
-    }
-
-    int chr;
-    
-    // skip spaces and tabs
-    while ((chr = fgetc(f)) != EOF) {
-        if (!isspace(chr)) {
-            break;
-        }
-    }
-    
-    if (chr == EOF) {
-        t->type = TOKEN_EOF;
-        strcpy(t->text, "");
-        return 0;
-    }
-    
-    // handle letters and keywords
-    if (isalpha(chr)) {
-        int i = 0;
-        t->text[i++] = chr;
-        
-        while ((chr = fgetc(f)) != EOF && isalnum(chr)) {
-            if (i < MAX_TOKEN_LEN - 1) {
-                t->text[i++] = chr;
-            }
-        }
-        
-        if (chr != EOF) ungetc(chr, f);
-        t->text[i] = '\0';
-        
-        // check if keywords
-        if (strcmp(t->text, "int") == 0) {
-            t->type = TOKEN_INT;
-        } else if (strcmp(t->text, "if") == 0) {
-            t->type = TOKEN_IF;
-        } else {
-            t->type = TOKEN_IDENTIFIER;
-        }
-        return 1;
-    }
-    
-    // handle numbers
-    if (isdigit(chr)) {
-        int i = 0;
-        t->text[i++] = chr;
-        
-        while ((chr = fgetc(f)) != EOF && isdigit(chr)) {
-            if (i < MAX_TOKEN_LEN - 1) {
-                t->text[i++] = chr;
-            }
-        }
-        
-        if (chr != EOF) ungetc(chr, f);
-        t->text[i] = '\0';
-        t->type = TOKEN_NUMBER;
-        return 1;
-    }
-    
-    // handle operators and symbols
-    switch (chr) {
-        case '=':
-            chr = fgetc(f);
-            if (chr == '=') {
-                t->type = TOKEN_EQUAL;
-                strcpy(t->text, "==");
-            } else {
-                if (chr != EOF) ungetc(chr, f);
-                t->type = TOKEN_ASSIGN;
-                strcpy(t->text, "=");
-            }
-            return 1;
-            
-        case '+':
-            t->type = TOKEN_PLUS;
-            strcpy(t->text, "+");
-            return 1;
-            
-        case '-':
-            t->type = TOKEN_MINUS;
-            strcpy(t->text, "-");
-            return 1;
-            
-        case '{':
-            t->type = TOKEN_LBRACE;
-            strcpy(t->text, "{");
-            return 1;
-            
-        case '}':
-            t->type = TOKEN_RBRACE;
-            strcpy(t->text, "}");
-            return 1;
-            
-        case '(':
-            t->type = TOKEN_LPAREN;
-            strcpy(t->text, "(");
-            return 1;
-            
-        case ')':
-            t->type = TOKEN_RPAREN;
-            strcpy(t->text, ")");
-            return 1;
-            
-        case ';':
-            t->type = TOKEN_SEMICOLON;
-            strcpy(t->text, ";");
-            return 1;
-            
-        case '/':
-            chr = fgetc(f);
-            if (chr == '/') {
-                // skip comment line
-                while ((chr = fgetc(f)) != EOF && chr != '\n');
-                return getNextToken(f, t);
-            } else {
-                if (chr != EOF) ungetc(chr, f);
-                t->type = TOKEN_UNKNOWN;
-                strcpy(t->text, "/");
-                return 1;
-            }
-            
-        default:
-            t->type = TOKEN_UNKNOWN;
-            t->text[0] = chr;
-            t->text[1] = '\0';
-            return 1;
-    }
-}
-
-// convert token type to readable string
-const char* get_token_string(TokenType tt) {
-    switch (tt) {
-        case TOKEN_INT: return "KEYWORD_INT";
-        case TOKEN_IF: return "KEYWORD_IF";
-        case TOKEN_IDENTIFIER: return "IDENTIFIER";
-        case TOKEN_NUMBER: return "NUMBER";
-        case TOKEN_ASSIGN: return "ASSIGN";
-        case TOKEN_PLUS: return "PLUS";
-        case TOKEN_MINUS: return "MINUS";
-        case TOKEN_EQUAL: return "EQUAL";
-        case TOKEN_LBRACE: return "LBRACE";
-        case TOKEN_RBRACE: return "RBRACE";
-        case TOKEN_LPAREN: return "LPAREN";
-        case TOKEN_RPAREN: return "RPAREN";
-        case TOKEN_SEMICOLON: return "SEMICOLON";
-        case TOKEN_UNKNOWN: return "UNKNOWN";
-        case TOKEN_EOF: return "EOF";
-        default: return "UNKNOWN";
-    }
+// Simple lexer for SimpleLang
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lexer.h"
+
+// initialize lexer over a source buffer
+void init_lexer(Lexer *lx, const char *buf, size_t len, Interner *names) {
+    lx->buf = buf;
+    lx->len = len;
+    lx->pos = 0;
+    lx->base = 0;
+    lx->line = 1;
+    lx->line_start = 0;
+    lx->stream = NULL;
+    lx->line_end = len;
+    lx->names = names;
+    lx->scan = scan_kernels();
+}
+
+// initialize lexer over a streamed source window
+void init_lexer_stream(Lexer *lx, SourceBuffer *src, Interner *names) {
+    init_lexer(lx, src->data, src->len, names);
+    lx->stream = src;
+    lx->base = src->base;
+    lx->line_end = 0;
+}
+
+// pointer to the first character of a token's span
+const char* token_text(const Lexer *lx, const Token *t) {
+    return lx->buf + (t->offset - lx->base);
+}
+
+// streamed input: drop everything before pos and read until the window
+// holds a complete line (tokens never span lines) or the input ends
+static size_t lexer_refill(Lexer *lx, size_t pos) {
+    SourceBuffer *src = lx->stream;
+    size_t keep = pos;
+    for (;;) {
+        size_t old_len = src->len - keep;
+        size_t n = source_refill(src, keep);
+        keep = 0;
+        
+        size_t i = src->len;
+        while (i > old_len && src->data[i - 1] != '\n') {
+            i--;
+        }
+        if (i > old_len || n == 0) {
+            lx->line_end = i > old_len ? i : src->len;
+            break;
+        }
+    }
+    lx->buf = src->data;
+    lx->len = src->len;
+    lx->base = src->base;
+    return 0;
+}
+
+// class of a token's first byte; bytes outside ASCII letters, digits,
+// whitespace and operators are 0 (unknown). Runs are measured by the
+// scan kernels.
+#define CC_SPACE    1
+#define CC_NEWLINE  2
+#define CC_ALPHA    4
+#define CC_DIGIT    8
+#define CC_PUNCT    16
+
+static const unsigned char char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, CC_SPACE, CC_NEWLINE, CC_SPACE, CC_SPACE, CC_SPACE, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    CC_SPACE, 0, 0, 0, 0, 0, 0, 0,
+    CC_PUNCT, CC_PUNCT, 0, CC_PUNCT, 0, CC_PUNCT, 0, CC_PUNCT,
+    CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT,
+    CC_DIGIT, CC_DIGIT, 0, CC_PUNCT, 0, CC_PUNCT, 0, 0,
+    0, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, 0, 0, 0, 0, 0,
+    0, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_PUNCT, 0, CC_PUNCT, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+// token for each single-character operator ('=' and '/' are checked
+// for their two-character forms first)
+static const unsigned char punct_token[256] = {
+    ['='] = TOKEN_ASSIGN,
+    ['+'] = TOKEN_PLUS,
+    ['-'] = TOKEN_MINUS,
+    ['{'] = TOKEN_LBRACE,
+    ['}'] = TOKEN_RBRACE,
+    ['('] = TOKEN_LPAREN,
+    [')'] = TOKEN_RPAREN,
+    [';'] = TOKEN_SEMICOLON,
+    ['/'] = TOKEN_UNKNOWN
+};
+
+// Keywords sit in a table indexed by a perfect hash of length, first
+// and last character, so a lookup is one compare whatever the keyword
+// count. A new keyword goes in the slot KEYWORD_HASH gives it; if that
+// slot is taken, change the hash so all keywords land apart again.
+#define KEYWORD_SLOTS 8
+#define KEYWORD_MIN_LEN 2
+#define KEYWORD_MAX_LEN 3
+#define KEYWORD_HASH(s, len) \
+    (((len) + (unsigned char)(s)[0] + (unsigned char)(s)[(len) - 1]) & (KEYWORD_SLOTS - 1))
+
+static const struct {
+    const char *text;
+    size_t len;
+    TokenType type;
+} keywords[KEYWORD_SLOTS] = {
+    [0] = { "int", 3, TOKEN_INT },      // 3 + 'i' + 't' = 224
+    [1] = { "if", 2, TOKEN_IF }         // 2 + 'i' + 'f' = 209
+};
+
+// Most runs are a few bytes long, too short to pay for a kernel call,
+// so the first INLINE_RUN bytes of each are scanned here
+#define INLINE_RUN 4
+
+// end of the run of class bits at pos, kernel for whatever is left
+static size_t skip_run(const char *buf, size_t pos, size_t len, unsigned char bits,
+                       size_t (*kernel)(const char *, size_t, size_t)) {
+    size_t stop = len - pos > INLINE_RUN ? pos + INLINE_RUN : len;
+    while (pos < stop && (char_class[(unsigned char)buf[pos]] & bits)) {
+        pos++;
+    }
+    if (pos == stop && pos < len && (char_class[(unsigned char)buf[pos]] & bits)) {
+        pos = kernel(buf, pos, len);
+    }
+    return pos;
+}
+
+// keyword token type for an identifier-shaped span, or TOKEN_IDENTIFIER
+static TokenType keyword_type(const char *s, size_t len) {
+    if (len < KEYWORD_MIN_LEN || len > KEYWORD_MAX_LEN) {
+        return TOKEN_IDENTIFIER;
+    }
+    unsigned int slot = KEYWORD_HASH(s, len);
+    if (keywords[slot].len == len && memcmp(keywords[slot].text, s, len) == 0) {
+        return keywords[slot].type;
+    }
+    return TOKEN_IDENTIFIER;
+}
+
+// Token parsing function
+int getNextToken(Lexer *lx, Token *t) {
+    const char *buf = lx->buf;
+    size_t len = lx->len;
+    size_t pos = lx->pos;
+    
+    // skip whitespace and comment lines, tracking line starts
+    for (;;) {
+        size_t stop = len - pos > INLINE_RUN ? pos + INLINE_RUN : len;
+        while (pos < stop && (char_class[(unsigned char)buf[pos]] & (CC_SPACE | CC_NEWLINE))) {
+            if (buf[pos] == '\n') {
+                lx->line++;
+                lx->line_start = lx->base + pos + 1;
+            }
+            pos++;
+        }
+        if (pos == stop && pos < len && (char_class[(unsigned char)buf[pos]] & (CC_SPACE | CC_NEWLINE))) {
+            int lines = 0;
+            size_t after_newline = 0;
+            pos = lx->scan->skip_space(buf, pos, len, &lines, &after_newline);
+            if (lines) {
+                lx->line += lines;
+                lx->line_start = lx->base + after_newline;
+            }
+        }
+        if (pos >= len) {
+            if (!lx->stream || lx->stream->eof) {
+                break;
+            }
+            pos = lexer_refill(lx, pos);
+            buf = lx->buf;
+            len = lx->len;
+            continue;
+        }
+        
+        // make sure the whole token (or comment) is inside the window
+        if (lx->stream && pos >= lx->line_end && !lx->stream->eof) {
+            pos = lexer_refill(lx, pos);
+            buf = lx->buf;
+            len = lx->len;
+        }
+        if (buf[pos] != '/' || pos + 1 >= len || buf[pos + 1] != '/') {
+            break;
+        }
+        pos = lx->scan->find_newline(buf, pos, len);
+    }
+    
+    size_t start = pos;
+    t->offset = lx->base + pos;
+    t->length = 1;
+    t->line = lx->line;
+    t->column = (int)(t->offset - lx->line_start) + 1;
+    t->sym = -1;
+    
+    if (pos >= len) {
+        lx->pos = pos;
+        t->type = TOKEN_EOF;
+        t->length = 0;
+        return 0;
+    }
+    
+    unsigned char chr = (unsigned char)buf[pos++];
+    switch (char_class[chr]) {
+        case CC_ALPHA:
+            // identifiers and keywords
+            pos = skip_run(buf, pos, len, CC_ALPHA | CC_DIGIT, lx->scan->skip_ident);
+            t->length = pos - start;
+            lx->pos = pos;
+            t->type = keyword_type(buf + start, t->length);
+            if (t->type == TOKEN_IDENTIFIER) {
+                t->sym = intern_symbol(lx->names, buf + start, t->length);
+            }
+            return 1;
+            
+        case CC_DIGIT:
+            pos = skip_run(buf, pos, len, CC_DIGIT, lx->scan->skip_digits);
+            t->length = pos - start;
+            lx->pos = pos;
+            t->type = TOKEN_NUMBER;
+            return 1;
+            
+        case CC_PUNCT:
+            lx->pos = pos;
+            t->type = (TokenType)punct_token[chr];
+            if (chr == '=' && pos < len && buf[pos] == '=') {
+                lx->pos = pos + 1;
+                t->type = TOKEN_EQUAL;
+                t->length = 2;
+            }
+            return 1;
+            
+        default:
+            lx->pos = pos;
+            t->type = TOKEN_UNKNOWN;
+            return 1;
+    }
+}
+
+// convert token type to readable string
+const char* get_token_string(TokenType tt) {
+    switch (tt) {
+        case TOKEN_INT: return "KEYWORD_INT";
+        case TOKEN_IF: return "KEYWORD_IF";
+        case TOKEN_IDENTIFIER: return "IDENTIFIER";
+        case TOKEN_NUMBER: return "NUMBER";
+        case TOKEN_ASSIGN: return "ASSIGN";
+        case TOKEN_PLUS: return "PLUS";
+        case TOKEN_MINUS: return "MINUS";
+        case TOKEN_EQUAL: return "EQUAL";
+        case TOKEN_LBRACE: return "LBRACE";
+        case TOKEN_RBRACE: return "RBRACE";
+        case TOKEN_LPAREN: return "LPAREN";
+        case TOKEN_RPAREN: return "RPAREN";
+        case TOKEN_SEMICOLON: return "SEMICOLON";
+        case TOKEN_UNKNOWN: return "UNKNOWN";
+        case TOKEN_EOF: return "EOF";
+        default: return "UNKNOWN";
+    }
 }
\ No newline at end of file
@@ -1,35 +1,59 @@
-#ifndef LEXER_H
-#define LEXER_H
-
-#include <stdio.h>
-
-// Token Types
-typedef enum {
-    TOKEN_INT,           
-    TOKEN_IDENTIFIER,    
-    TOKEN_NUMBER,        
-    TOKEN_ASSIGN,        
-    TOKEN_PLUS,          
-    TOKEN_MINUS,
-    TOKEN_IF,            
-    TOKEN_EQUAL,         
-    TOKEN_LBRACE,        
-    TOKEN_RBRACE,        
-    TOKEN_LPAREN,        
-    TOKEN_RPAREN,        
-    TOKEN_SEMICOLON,     
-    TOKEN_UNKNOWN,       
-    TOKEN_EOF            
-} TokenType;
-
-// Token structure
-typedef struct {
-    TokenType type;
-    char text[100];
-} Token;
-
-// Function declarations
-const char* token_type_to_string(TokenType type);
-int getNextToken(FILE* file, Token *token);
-
-#endif
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+#include "source.h"
+#include "intern.h"
+#include "scan.h"
+
+// Token Types
+typedef enum {
+    TOKEN_INT,           
+    TOKEN_IDENTIFIER,    
+    TOKEN_NUMBER,        
+    TOKEN_ASSIGN,        
+    TOKEN_PLUS,          
+    TOKEN_MINUS,
+    TOKEN_IF,            
+    TOKEN_EQUAL,         
+    TOKEN_LBRACE,        
+    TOKEN_RBRACE,        
+    TOKEN_LPAREN,        
+    TOKEN_RPAREN,        
+    TOKEN_SEMICOLON,     
+    TOKEN_UNKNOWN,       
+    TOKEN_EOF            
+} TokenType;
+
+// Token structure (span into the source buffer, no copied text)
+typedef struct {
+    TokenType type;
+    size_t offset;
+    size_t length;
+    int line;
+    int column;
+    int sym;        // interned symbol ID for identifiers, -1 otherwise
+} Token;
+
+// Lexer state over an in-memory source buffer (or a streamed window of it)
+typedef struct {
+    const char *buf;
+    size_t len;
+    size_t pos;             // index into buf
+    size_t base;            // absolute input offset of buf[0]
+    int line;
+    size_t line_start;      // absolute offset of the current line
+    SourceBuffer *stream;   // set when buf is a refillable window
+    size_t line_end;        // buf index just past the last complete line
+    Interner *names;        // identifiers are interned here
+    const ScanKernels *scan;    // run scanners for this CPU
+} Lexer;
+
+// Function declarations
+const char* token_type_to_string(TokenType type);
+void init_lexer(Lexer *lx, const char *buf, size_t len, Interner *names);
+void init_lexer_stream(Lexer *lx, SourceBuffer *src, Interner *names);
+int getNextToken(Lexer *lx, Token *token);
+const char* token_text(const Lexer *lx, const Token *token);
+
+#endif
\ No newline at end of file
@@ -1,73 +1,608 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include "parser.h"
-
-// declare functions from codegen
-void init_codegen(void);
-void collect_declarations(ASTNode *node);
-void generate_code(ASTNode *node, int depth);
-void destroy_ast(ASTNode* node);
-
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf("Usage: %s <input_file>\n", argv[0]);
-        printf("Example: %s example.simplelang\n\n", argv[0]);
-        printf("SimpleLang Compiler for 8-bit CPU\n");
-        printf("==================================\n");
-        printf("Supports:\n");
-        printf("  - Variable declarations\n");
-        printf("  - Arithmetic operations\n");
-        printf("  - Conditional statements\n");
-        return 1;
-    }
-    
-    FILE *infile = fopen(argv[1], "r");
-    if (!infile) {
-        printf("Could not open file '%s'\n", argv[1]);
-        return 1;
-    }
-    
-    printf("SimpleLang Compiler for 8-bit CPU\n");
-    printf("==================================\n");
-    printf("Input file: %s\n\n", argv[1]);
-    
-    // initialize parser
-    init_parser(infile);
-    
-    // parse input
-    printf("Parsing SimpleLang source code...\n");
-    ASTNode *ast = parse_program();
-    printf("Parsing completed successfully!\n\n");
-    
-    // collect all variable declarations first
-    printf("Collecting variable declarations...\n");
-    init_codegen();
-    collect_declarations(ast);
-    
-    // print AST structure
-    printf("Generated AST:\n");
-    print_ast(ast, 0);
-    printf("\n");
-    
-    // generate assembly
-    printf("Generating assembly code...\n");
-    printf("============================\n");
-    
-    generate_code(ast, 0);
-    
-    printf("\nAssembly generation completed!\n");
-    
-    printf("\nCompiler Statistics:\n");
-    printf("===================\n");
-    printf("Variables declared: Available in generated assembly\n");
-    printf("Memory addresses used: Starting from address 100\n");
-    printf("Labels generated: Available in generated assembly\n");
-    
-    // cleanup
-    fclose(infile);
-    destroy_ast(ast);
-    // cleanup handled in parser
-    
-    printf("\nCompiler execution completed successfully!\n");
-    return 0;
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "compiler.h"
+#include "batch.h"
+#include "cache.h"
+#include "incremental.h"
+#include "server.h"
+#include "simulate.h"
+#include "stats.h"
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--mem-size N] [--stream] [--cache-dir DIR] [--incremental] <input_file | ->\n", prog);
+    printf("       %s [-q] [-o OUT.asm] [--mem-size N] [--stream] [--cache-dir DIR] <input_file | ->\n", prog);
+    printf("       %s [-q] [--lex-jobs N] [--codegen-jobs N] <input_file>\n", prog);
+    printf("       %s [-q] [--mem-size N] --emit=bin -o OUT.bin <input_file>\n", prog);
+    printf("       %s [--mem-size N] [--jobs N] [--manifest FILE] [--cache-dir DIR] <input_file>...\n", prog);
+    printf("       %s --cache-dir DIR --cache-stats\n", prog);
+    printf("       %s [--mem-size N] --serve SOCKET\n", prog);
+    printf("       %s --connect SOCKET <input_file>\n", prog);
+    printf("       %s --connect SOCKET --server-stats\n", prog);
+    printf("Example: %s example.simplelang\n", prog);
+    printf("--mem-size N sets the target's data memory, 1 to %d bytes (default %d).\n",
+           MAX_DATA_MEM_SIZE, DEFAULT_DATA_MEM_SIZE);
+    printf("The cache directory can also be set with SIMPLELANG_CACHE_DIR;\n");
+    printf("--cache-size MB bounds it (default %llu MB).\n", DEFAULT_CACHE_MAX_BYTES >> 20);
+    printf("-O0 turns off constant folding and peephole optimization (default -O%d);\n", DEFAULT_OPT_LEVEL);
+    printf("-O2 also packs variables with disjoint lifetimes into shared data slots.\n");
+    printf("--emit=bin writes machine code to OUT.bin and a listing to OUT.lst.\n");
+    printf("-q prints only the assembly, without banner, AST dump or statistics;\n");
+    printf("-o OUT.asm writes it to OUT.asm instead of stdout.\n");
+    printf("--run executes the program on a simulated CPU and reports cycles,\n");
+    printf("instruction counts and the final value of every variable.\n");
+    printf("--codegen-jobs N generates code for the top-level statements on N\n");
+    printf("threads; the output is the same as with one.\n");
+    printf("--lex-jobs N lexes the whole input on N threads before parsing\n");
+    printf("(not with --stream); the output is the same as with one.\n");
+    printf("--stats adds phase timings, counts and memory use to the statistics;\n");
+    printf("--stats-json FILE writes them as JSON (\"-\" for stdout).\n\n");
+    printf("SimpleLang Compiler for 8-bit CPU\n");
+    printf("==================================\n");
+    printf("Supports:\n");
+    printf("  - Variable declarations\n");
+    printf("  - Arithmetic operations\n");
+    printf("  - Conditional statements\n");
+}
+
+// listing of a binary image goes next to it: OUT.bin -> OUT.lst
+static int write_listing_file(Compiler *ctx, const MachineImage *img, const char *bin_path) {
+    size_t len = strlen(bin_path);
+    if (len > 4 && strcmp(bin_path + len - 4, ".bin") == 0) {
+        len -= 4;
+    }
+    char *path = (char*)malloc(len + 5);
+    if (!path) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    memcpy(path, bin_path, len);
+    strcpy(path + len, ".lst");
+    FILE *f = fopen(path, "w");
+    free(path);
+    if (!f) {
+        return 0;
+    }
+    
+    OutputSink out;
+    init_file_sink(&out, f);
+    write_listing(img, &ctx->names, &out);
+    sink_printf(&out, "\n.data\n");
+    for (int i = 0; i < ctx->cg.var_idx; i++) {
+        sink_printf(&out, "%s_addr = %d\n", symbol_name(&ctx->names, ctx->cg.vars[i].sym),
+                    ctx->cg.vars[i].addr);
+    }
+    return fclose(f) == 0;
+}
+
+// run the image on the simulated CPU and describe the run in report
+static void simulate_image(Compiler *ctx, const MachineImage *img, StringBuffer *report) {
+    Simulator sim;
+    init_simulator(&sim, ctx->options.mem_size);
+    run_simulator(&sim, img, &ctx->err);
+    
+    OutputSink out;
+    init_string_sink(&out, report);
+    sink_printf(&out, "\nSimulation:\n");
+    sink_printf(&out, "===========\n");
+    sink_printf(&out, "Cycles: %llu\n", sim.cycles);
+    sink_printf(&out, "Instructions executed: %llu\n", sim.instructions);
+    for (int op = 0; op < SIM_OP_COUNT; op++) {
+        sink_printf(&out, "  %-10s %llu\n", sim_op_name(op), sim.counts[op]);
+    }
+    sink_printf(&out, "Final memory:\n");
+    for (int i = 0; i < ctx->cg.var_idx; i++) {
+        int addr = ctx->cg.vars[i].addr;
+        sink_printf(&out, "  %s = %d (address %d)\n", symbol_name(&ctx->names, ctx->cg.vars[i].sym),
+                    sim.mem[addr], addr);
+    }
+    free_simulator(&sim);
+}
+
+// what the compile_source hooks of a single-file compile need and report
+typedef struct {
+    CompileStats *st;
+    double phase_ms;            // start of the phase in progress
+    int quiet;
+    const char *input_path;
+    const char *out_path;
+    int emit_bin;
+    int run_sim;
+    int reused;                 // statements taken from the incremental index
+    int lowered;
+    size_t code_bytes;
+    StringBuffer *sim_report;
+} CompileRun;
+
+static void run_begin_phase(void *user, Compiler *ctx, CompilePhase phase, NodeId root) {
+    CompileRun *run = (CompileRun*)user;
+    if (!run->quiet) {
+        if (phase == PHASE_PARSE) {
+            printf("Parsing SimpleLang source code...\n");
+        } else if (phase == PHASE_COLLECT) {
+            // collect all variable declarations first
+            printf("Collecting variable declarations...\n");
+        } else if (phase == PHASE_OPTIMIZE) {
+            // fold constant expressions before the AST is printed and lowered
+            printf("Folding constants...\n");
+        } else if (phase == PHASE_CODEGEN) {
+            printf("Generated AST:\n");
+            print_ast(&ctx->names, &ctx->ast, root, 0);
+            printf("\n");
+            printf("Generating assembly code...\n");
+            printf("============================\n");
+            fflush(stdout);
+        }
+    }
+    run->phase_ms = stats_now_ms();
+}
+
+static void run_end_phase(void *user, Compiler *ctx, CompilePhase phase) {
+    CompileRun *run = (CompileRun*)user;
+    stats_end_phase(run->st, phase, run->phase_ms);
+    if (phase == PHASE_PARSE && !run->quiet) {
+        printf("Parsing completed successfully!\n\n");
+    } else if (phase == PHASE_CODEGEN) {
+        run->st->variables = ctx->cg.var_idx;
+        run->st->data_slots = ctx->cg.pack_slots ? ctx->cg.slots_after : ctx->cg.var_idx;
+    }
+}
+
+// reuse fragments of statements unchanged since the last compile
+static void generate_with_index(CompileRun *run, Compiler *ctx, NodeId root) {
+    char *index_path = (char*)malloc(strlen(run->input_path) + 5);
+    if (!index_path) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    sprintf(index_path, "%s.idx", run->input_path);
+    
+    IncrementalIndex prev, next;
+    init_incremental_index(&prev);
+    init_incremental_index(&next);
+    load_incremental_index(&prev, index_path, &ctx->options);
+    generate_incremental(&ctx->cg, &ctx->ast, root, &prev, &next);
+    save_incremental_index(&next, index_path, &ctx->options);
+    run->reused = next.reused;
+    run->lowered = next.count - next.reused;
+    free_incremental_index(&prev);
+    free_incremental_index(&next);
+    free(index_path);
+}
+
+// encode machine code alongside the assembly text
+static void generate_image(CompileRun *run, Compiler *ctx, NodeId root) {
+    MachineImage image;
+    init_image(&image, ctx->options.mem_size);
+    set_machine_image(&ctx->cg, &image);
+    generate_code(&ctx->cg, &ctx->ast, root, 0);
+    int written = 1;
+    if (run->emit_bin) {
+        written = write_image(&image, run->out_path) && write_listing_file(ctx, &image, run->out_path);
+        run->code_bytes = image.len;
+    }
+    if (written && run->run_sim) {
+        simulate_image(ctx, &image, run->sim_report);
+    }
+    free_image(&image);
+    if (!written) {
+        raise_error(&ctx->err, "Could not write '%s'", run->out_path);
+    }
+}
+
+static void run_generate(void *user, Compiler *ctx, NodeId root) {
+    CompileRun *run = (CompileRun*)user;
+    if (ctx->options.incremental) {
+        generate_with_index(run, ctx, root);
+    } else if (run->emit_bin || run->run_sim) {
+        generate_image(run, ctx, root);
+    } else {
+        generate_code(&ctx->cg, &ctx->ast, root, 0);
+    }
+}
+
+// JSON statistics to path, "-" for stdout
+static int write_stats_json_file(const CompileStats *st, const char *path) {
+    FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!f) {
+        return 0;
+    }
+    OutputSink out;
+    init_file_sink(&out, f);
+    write_stats_json(st, &out);
+    return f == stdout ? fflush(f) == 0 : fclose(f) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char **inputs = (const char**)malloc(sizeof(char*) * argc);
+    int input_count = 0;
+    const char *manifest = NULL;
+    const char *serve_path = NULL;
+    const char *connect_path = NULL;
+    int server_stats = 0;
+    const char *cache_dir = getenv("SIMPLELANG_CACHE_DIR");
+    unsigned long long cache_max = DEFAULT_CACHE_MAX_BYTES;
+    int cache_stats = 0;
+    int mem_size = DEFAULT_DATA_MEM_SIZE;
+    int opt_level = DEFAULT_OPT_LEVEL;
+    int stream_mode = 0;
+    int incremental = 0;
+    int emit_bin = 0;
+    int quiet = 0;
+    int run_sim = 0;
+    int show_stats = 0;
+    const char *stats_json = NULL;
+    const char *out_path = NULL;
+    int jobs = 0;
+    int codegen_jobs = 1;
+    int lex_jobs = 1;
+    int bad_args = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mem-size") == 0 && i + 1 < argc) {
+            // data addresses are encoded in at most two bytes
+            char *end;
+            long size = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end || size < 1 || size > MAX_DATA_MEM_SIZE) {
+                bad_args = 1;
+            } else {
+                mem_size = (int)size;
+            }
+        } else if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '9' &&
+                   argv[i][3] == '\0') {
+            opt_level = argv[i][2] - '0';
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream_mode = 1;
+        } else if (strcmp(argv[i], "--incremental") == 0) {
+            incremental = 1;
+        } else if (strcmp(argv[i], "--emit=bin") == 0) {
+            emit_bin = 1;
+        } else if (strcmp(argv[i], "--emit=asm") == 0) {
+            emit_bin = 0;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = 1;
+        } else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+            stats_json = argv[++i];
+        } else if (strcmp(argv[i], "--run") == 0) {
+            run_sim = 1;
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = 1;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+            if (jobs < 1) {
+                bad_args = 1;
+            }
+        } else if (strcmp(argv[i], "--codegen-jobs") == 0 && i + 1 < argc) {
+            codegen_jobs = atoi(argv[++i]);
+            if (codegen_jobs < 1) {
+                bad_args = 1;
+            }
+        } else if (strcmp(argv[i], "--lex-jobs") == 0 && i + 1 < argc) {
+            lex_jobs = atoi(argv[++i]);
+            if (lex_jobs < 1) {
+                bad_args = 1;
+            }
+        } else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+            manifest = argv[++i];
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            connect_path = argv[++i];
+        } else if (strcmp(argv[i], "--server-stats") == 0) {
+            server_stats = 1;
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+            cache_max = strtoull(argv[++i], NULL, 10) << 20;
+        } else if (strcmp(argv[i], "--cache-stats") == 0) {
+            cache_stats = 1;
+        } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            inputs[input_count++] = argv[i];
+        } else {
+            bad_args = 1;
+        }
+    }
+    
+    // long-lived compile server and its thin client
+    if (!bad_args && serve_path && input_count == 0) {
+        CompileOptions opts;
+        opts.mem_size = mem_size;
+        opts.opt_level = opt_level;
+        opts.incremental = 0;
+        free(inputs);
+        return serve(serve_path, &opts);
+    }
+    if (!bad_args && connect_path && server_stats && input_count == 0) {
+        free(inputs);
+        return client_stats(connect_path);
+    }
+    if (!bad_args && connect_path && !server_stats && input_count == 1) {
+        int status = client_compile(connect_path, inputs[0]);
+        free(inputs);
+        return status;
+    }
+    if (serve_path || connect_path || server_stats) {
+        bad_args = 1;
+    }
+    // machine code comes from the instruction list, which cached or
+    // reused assembly text no longer has
+    if (emit_bin && !out_path) {
+        bad_args = 1;
+    }
+    if ((emit_bin || run_sim) && (stream_mode || incremental)) {
+        bad_args = 1;
+    }
+    // -o FILE alone writes just the assembly to FILE
+    if (out_path && !emit_bin) {
+        quiet = 1;
+    }
+    
+    // on-disk cache of generated assembly, shared between runs
+    Cache cache;
+    Cache *use_cache = NULL;
+    if (!bad_args && cache_dir && *cache_dir && !emit_bin && !run_sim) {
+        if (!cache_open(&cache, cache_dir, cache_max)) {
+            printf("Could not open cache directory '%s'\n", cache_dir);
+            return 1;
+        }
+        use_cache = &cache;
+    }
+    if (cache_stats) {
+        int status = 1;
+        if (use_cache && input_count == 0) {
+            status = cache_print_stats(use_cache);
+        } else {
+            print_usage(argv[0]);
+        }
+        if (use_cache) {
+            cache_close(use_cache);
+        }
+        free(inputs);
+        return status;
+    }
+    
+    // batch mode: many units, each written to its own .asm file
+    if (!bad_args && (jobs > 0 || manifest || input_count > 1) && !stream_mode && !out_path) {
+        char **listed = NULL;
+        int listed_count = 0;
+        if (manifest) {
+            listed = read_manifest(manifest, &listed_count);
+            if (!listed) {
+                printf("Could not open manifest '%s'\n", manifest);
+                return 1;
+            }
+        }
+        
+        const char **all = (const char**)malloc(sizeof(char*) * (input_count + listed_count + 1));
+        int count = 0;
+        for (int i = 0; i < input_count; i++) {
+            all[count++] = inputs[i];
+        }
+        for (int i = 0; i < listed_count; i++) {
+            all[count++] = listed[i];
+        }
+        
+        CompileOptions opts;
+        opts.mem_size = mem_size;
+        opts.opt_level = opt_level;
+        opts.incremental = 0;
+        int failed = batch_compile(all, count, jobs, &opts, use_cache);
+        if (use_cache) {
+            cache_close(use_cache);
+        }
+        
+        free(all);
+        free_manifest(listed, listed_count);
+        free(inputs);
+        return failed ? 1 : 0;
+    }
+    
+    if (input_count != 1 || bad_args || (incremental && (stream_mode || strcmp(inputs[0], "-") == 0))) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const char *input_path = inputs[0];
+    free(inputs);
+    
+    SourceBuffer src;
+    int opened = stream_mode ? source_open_stream(&src, input_path)
+                             : source_open(&src, input_path);
+    if (!opened) {
+        printf("Could not open file '%s'\n", input_path);
+        return 1;
+    }
+    
+    // assembly goes to stdout, or to the -o file, or only to the listing
+    // of a quiet binary build
+    int out_fd = 1;
+    if (out_path && !emit_bin) {
+        out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) {
+            printf("Could not create file '%s'\n", out_path);
+            return 1;
+        }
+    }
+    
+    if (!quiet) {
+        printf("SimpleLang Compiler for 8-bit CPU\n");
+        printf("==================================\n");
+        printf("Input file: %s\n\n", input_path);
+    }
+    
+    // all compiler state lives in one context, AST nodes in its pool
+    Compiler ctx;
+    compiler_init(&ctx);
+    ctx.options.mem_size = mem_size;
+    ctx.options.opt_level = opt_level;
+    ctx.options.incremental = incremental;
+    ctx.codegen_jobs = codegen_jobs;
+    ctx.lex_jobs = lex_jobs;
+    
+    CompileStats st;
+    init_compile_stats(&st, input_path, src.len, opt_level);
+    double start_ms = stats_now_ms();
+    int lowered_here = 0;
+    
+    FdBuffer asm_buf;
+    OutputSink dest;
+    init_fd_sink(&dest, &asm_buf, out_fd);
+    if (quiet && emit_bin) {
+        init_null_sink(&dest);
+    }
+    OutputSink out = dest;
+    
+    // with a cache the assembly is collected first so it can be stored
+    char key[65];
+    StringBuffer asm_text = { NULL, 0, 0 };
+    StringBuffer sim_report = { NULL, 0, 0 };
+    CompileRun run;
+    memset(&run, 0, sizeof(run));
+    run.st = &st;
+    run.quiet = quiet;
+    run.input_path = input_path;
+    run.out_path = out_path;
+    run.emit_bin = emit_bin;
+    run.run_sim = run_sim;
+    run.sim_report = &sim_report;
+    if (use_cache && !stream_mode) {
+        cache_key(&ctx.options, src.data, src.len, key);
+        init_string_sink(&out, &asm_text);
+    }
+    
+    if (stream_mode) {
+        if (!quiet) {
+            printf("Streaming compilation (one statement at a time)...\n");
+            printf("============================\n");
+            fflush(stdout);
+        }
+        if (compile_stream(&ctx, &src, &out) != 0) {
+            printf("%s\n", compiler_error(&ctx));
+            return 1;
+        }
+    } else if (use_cache && cache_lookup(use_cache, key, &asm_text)) {
+        // identical source and options were compiled before
+        if (!quiet) {
+            printf("Cache hit: %s\n", key);
+            printf("============================\n");
+            fflush(stdout);
+        }
+        sink_write(&dest, asm_text.data, asm_text.len);
+        st.cached = 1;
+    } else {
+        // parsing lexes as it goes, a separate pass times the lexer alone
+        if (ctx.lex_jobs <= 1 && (show_stats || stats_json)) {
+            stats_time_lexing(&st, &src);
+        }
+        CompileHooks hooks = { &run, run_begin_phase, run_end_phase, run_generate };
+        if (compile_source(&ctx, &src, &out, &hooks) != 0) {
+            printf("%s\n", compiler_error(&ctx));
+            return 1;
+        }
+        lowered_here = 1;
+        
+        if (use_cache) {
+            sink_write(&dest, asm_text.data, asm_text.len);
+            cache_store(use_cache, key, asm_text.data, asm_text.len);
+        }
+    }
+    int written = flush_fd_buffer(&asm_buf);
+    free_fd_buffer(&asm_buf);
+    if (out_fd != 1 && close(out_fd) != 0) {
+        written = 0;
+    }
+    if (!written) {
+        printf("Could not write assembly output\n");
+        return 1;
+    }
+    if (sim_report.len > 0) {
+        fwrite(sim_report.data, 1, sim_report.len, stdout);
+    }
+    free_string_buffer(&sim_report);
+    
+    stats_finish(&st, start_ms);
+    st.tokens = ctx.parser.tokens;
+    st.ast_nodes = ctx.parser.nodes;
+    st.instructions = ctx.cg.instructions;
+    st.labels = ctx.cg.label_num;
+    st.symbols = symbol_count(&ctx.names);
+    st.ast_peak = ast_peak_bytes(&ctx.ast);
+    st.ast_grows = ctx.ast.grows;
+    st.ir_grows = ctx.cg.ir_grows;
+    st.intern_grows = ctx.names.grows;
+    st.token_grows = ctx.tokens.grows;
+    st.intern_lookups = ctx.names.lookups;
+    st.intern_probes = ctx.names.probes;
+    st.var_lookups = ctx.cg.var_lookups;
+    st.var_probes = ctx.cg.var_probes;
+    if (stats_json && !write_stats_json_file(&st, stats_json)) {
+        printf("Could not write '%s'\n", stats_json);
+        return 1;
+    }
+    if (quiet && show_stats) {
+        OutputSink stats_out;
+        init_file_sink(&stats_out, stdout);
+        print_compile_stats(&st, &stats_out);
+    }
+    
+    if (quiet) {
+        compiler_free(&ctx);
+        source_close(&src);
+        free_string_buffer(&asm_text);
+        if (use_cache) {
+            cache_close(use_cache);
+        }
+        return 0;
+    }
+    
+    printf("\nAssembly generation completed!\n");
+    
+    printf("\nCompiler Statistics:\n");
+    printf("===================\n");
+    if (lowered_here) {
+        printf("Variables declared: %d\n", st.variables);
+        if (st.data_slots > 0) {
+            printf("Memory addresses used: 100-%d\n", 100 + st.data_slots - 1);
+        }
+        printf("Labels generated: %d\n", st.labels);
+    }
+    printf("AST memory used (peak): %zu bytes\n", ast_peak_bytes(&ctx.ast));
+    if (incremental) {
+        printf("Incremental: %d statements reused, %d re-lowered\n", run.reused, run.lowered);
+    }
+    if (emit_bin) {
+        printf("Machine code: %zu bytes written to %s\n", run.code_bytes, out_path);
+    }
+    if (ctx.options.opt_level >= 1) {
+        printf("Constants folded: %d expressions, %d variable reads propagated\n",
+               ctx.opt.folded, ctx.opt.propagated);
+        if (ctx.cg.pack_slots) {
+            printf("Data slots: %d before packing, %d after\n",
+                   ctx.cg.slots_before, ctx.cg.slots_after);
+        }
+        printf("Peephole rule hits:\n");
+        for (int r = 0; r < PEEP_RULE_COUNT; r++) {
+            printf("  %-28s %llu\n", peephole_rule_name(r), ctx.cg.peep.hits[r]);
+        }
+    }
+    if (show_stats) {
+        OutputSink stats_out;
+        init_file_sink(&stats_out, stdout);
+        print_compile_stats(&st, &stats_out);
+    }
+    
+    // cleanup
+    compiler_free(&ctx);
+    source_close(&src);
+    free_string_buffer(&asm_text);
+    if (use_cache) {
+        cache_close(use_cache);
+    }
+    // cleanup handled in parser
+    
+    printf("\nCompiler execution completed successfully!\n");
+    return 0;
 }
\ No newline at end of file
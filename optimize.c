@@ -0,0 +1,240 @@
+// Constant folding and constant propagation pass
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+
+// the target is an 8-bit machine, folded values wrap like its adder
+#define WORD_MASK 0xFF
+
+static void* opt_realloc(void *p, size_t size) {
+    void *grown = realloc(p, size);
+    if (!grown) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    return grown;
+}
+
+void init_optimizer(Optimizer *o) {
+    memset(o, 0, sizeof(*o));
+}
+
+// forget all known values and counters before the next compilation
+void reset_optimizer(Optimizer *o) {
+    if (o->sym_cap > 0) {
+        memset(o->known, 0, o->sym_cap);
+    }
+    o->depth = 0;
+    o->log_top = 0;
+    o->folded = 0;
+    o->propagated = 0;
+}
+
+void cleanup_optimizer(Optimizer *o) {
+    free(o->value);
+    free(o->known);
+    free(o->seen);
+    free(o->log);
+    free(o->fold);
+    free(o->frames);
+    init_optimizer(o);
+}
+
+// symbols are interned while parsing, so tables grow on demand
+static void reserve_symbol(Optimizer *o, int sym) {
+    if (sym < o->sym_cap) {
+        return;
+    }
+    int cap = o->sym_cap ? o->sym_cap : 64;
+    while (cap <= sym) {
+        cap *= 2;
+    }
+    o->value = (int*)opt_realloc(o->value, sizeof(int) * cap);
+    o->known = (unsigned char*)opt_realloc(o->known, cap);
+    o->seen = (int*)opt_realloc(o->seen, sizeof(int) * cap);
+    memset(o->known + o->sym_cap, 0, cap - o->sym_cap);
+    memset(o->seen + o->sym_cap, 0, sizeof(int) * (cap - o->sym_cap));
+    o->sym_cap = cap;
+}
+
+// record a variable's new state; inside an if block the old state is
+// logged so the join after the block can compare both paths
+static void set_value(Optimizer *o, int sym, int known, int value) {
+    reserve_symbol(o, sym);
+    if (o->depth > 0) {
+        if (o->log_top == o->log_cap) {
+            o->log_cap = o->log_cap ? o->log_cap * 2 : 64;
+            o->log = (ConstUndo*)opt_realloc(o->log, sizeof(ConstUndo) * o->log_cap);
+        }
+        o->log[o->log_top].sym = sym;
+        o->log[o->log_top].known = o->known[sym];
+        o->log[o->log_top].value = o->value[sym];
+        o->log_top++;
+    }
+    o->known[sym] = (unsigned char)known;
+    o->value[sym] = value;
+}
+
+// value of an operand that is not folded further: numbers, and
+// variables with a known value (replaced by it)
+static int fold_leaf(Optimizer *o, AST *t, NodeId n, int *v) {
+    if (n == AST_NONE) return 0;
+    
+    if (t->kind[n] == AST_NUMBER) {
+        *v = AST_INT(t, n);
+        return 1;
+    }
+    if (t->kind[n] == AST_IDENTIFIER) {
+        int sym = AST_SYM(t, n);
+        if (sym >= o->sym_cap || !o->known[sym]) {
+            return 0;
+        }
+        t->kind[n] = AST_NUMBER;
+        AST_INT(t, n) = o->value[sym];
+        o->propagated++;
+        *v = AST_INT(t, n);
+        return 1;
+    }
+    return 0;
+}
+
+// fold n in place if its value is known at compile time; returns 1
+// and stores the value when it is. Operators wait on o->fold while
+// their operands are folded, left before right.
+static int fold_expr(Optimizer *o, AST *t, NodeId n, int *v) {
+    int top = 0;
+    int known;
+    int value = 0;
+    for (;;) {
+        // a comparison only sets the flag, it has no value to fold
+        while (n != AST_NONE && t->kind[n] == AST_BINARY_OP && t->op[n] != OP_EQUAL) {
+            if (top == o->fold_cap) {
+                o->fold_cap = o->fold_cap ? o->fold_cap * 2 : 64;
+                o->fold = (FoldFrame*)opt_realloc(o->fold, sizeof(FoldFrame) * o->fold_cap);
+            }
+            o->fold[top].node = n;
+            o->fold[top].has_left = 0;
+            top++;
+            n = AST_LEFT(t, n);
+        }
+        known = fold_leaf(o, t, n, &value);
+        
+        // combine finished operands; a right operand that is itself an
+        // operator is folded on the next round, leaves are folded here
+        int descend = 0;
+        while (top > 0) {
+            FoldFrame *f = &o->fold[top - 1];
+            NodeId op = f->node;
+            int left_known = f->left_known;
+            int left = f->left;
+            if (!f->has_left) {
+                NodeId right = AST_RIGHT(t, op);
+                if (right != AST_NONE && t->kind[right] == AST_BINARY_OP && t->op[right] != OP_EQUAL) {
+                    f->has_left = 1;
+                    f->left_known = known;
+                    f->left = value;
+                    n = right;
+                    descend = 1;
+                    break;
+                }
+                left_known = known;
+                left = value;
+                known = fold_leaf(o, t, right, &value);
+            }
+            top--;
+            if (!left_known || !known) {
+                known = 0;
+                continue;
+            }
+            int result = t->op[op] == OP_ADD ? left + value : left - value;
+            t->kind[op] = AST_NUMBER;
+            AST_INT(t, op) = result & WORD_MASK;
+            o->folded++;
+            value = AST_INT(t, op);
+        }
+        if (!descend) {
+            break;
+        }
+    }
+    *v = value;
+    return known;
+}
+
+// after an if block: a variable assigned inside stays known only if it
+// holds the same value whether or not the block ran
+static void join_block(Optimizer *o, int mark) {
+    int keep = mark;
+    o->stamp++;
+    for (int i = mark; i < o->log_top; i++) {
+        ConstUndo e = o->log[i];
+        if (o->seen[e.sym] == o->stamp) {
+            continue;
+        }
+        // first entry in the block holds the value from before it
+        o->seen[e.sym] = o->stamp;
+        int same = e.known && o->known[e.sym] && e.value == o->value[e.sym];
+        o->known[e.sym] = (unsigned char)same;
+        o->value[e.sym] = e.value;
+        o->log[keep++] = e;
+    }
+    // enclosing blocks only need the first entry per variable, dropping
+    // the rest keeps deeply nested joins from rescanning every assignment
+    o->log_top = o->depth == 0 ? 0 : keep;
+}
+
+static void push_frame(Optimizer *o, int top, NodeId block, int mark) {
+    if (top == o->frame_cap) {
+        o->frame_cap = o->frame_cap ? o->frame_cap * 2 : 64;
+        o->frames = (OptFrame*)opt_realloc(o->frames, sizeof(OptFrame) * o->frame_cap);
+    }
+    o->frames[top].block = block;
+    o->frames[top].next = 0;
+    o->frames[top].mark = mark;
+}
+
+// optimize a program, block or single top-level statement; values
+// carry over between calls until reset_optimizer. Open blocks live on
+// o->frames, an if block is joined when its last statement is done.
+void optimize_program(Optimizer *o, AST *t, NodeId node) {
+    int top = 0;
+    while (node != AST_NONE) {
+        switch (t->kind[node]) {
+            case AST_PROGRAM:
+                push_frame(o, top++, node, -1);
+                break;
+                
+            case AST_ASSIGNMENT:
+                {
+                    int v;
+                    int known = fold_expr(o, t, AST_EXPR(t, node), &v);
+                    set_value(o, AST_SYM(t, node), known, known ? v & WORD_MASK : 0);
+                }
+                break;
+                
+            case AST_CONDITIONAL:
+                // the condition is left alone, the block may or may not run
+                push_frame(o, top++, AST_BLOCK(t, node), o->log_top);
+                o->depth++;
+                break;
+                
+            default:
+                break;
+        }
+        
+        // next statement of the innermost open block
+        node = AST_NONE;
+        while (top > 0) {
+            OptFrame *f = &o->frames[top - 1];
+            if (f->block != AST_NONE && f->next < AST_COUNT(t, f->block)) {
+                node = AST_STMTS(t, f->block)[f->next++];
+                break;
+            }
+            top--;
+            if (f->mark >= 0) {
+                o->depth--;
+                join_block(o, f->mark);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "parser.h"
+
+// undo record: value of a variable before an assignment inside a block
+typedef struct {
+    int sym;
+    int known;
+    int value;
+} ConstUndo;
+
+// binary operation being folded; the left operand's result is kept
+// while the right one is worked on
+typedef struct {
+    NodeId node;
+    int has_left;
+    int left_known;
+    int left;
+} FoldFrame;
+
+// block being optimized; mark is the undo log position when an if
+// block opened, -1 for the program
+typedef struct {
+    NodeId block;
+    int next;
+    int mark;
+} OptFrame;
+
+// Constant folding and propagation over the AST. Values known for
+// each variable flow through straight-line code; after an if block
+// only values that agree on both paths survive.
+typedef struct {
+    int *value;             // indexed by symbol ID
+    unsigned char *known;
+    int *seen;              // join stamp per symbol
+    int sym_cap;
+    int stamp;
+    int depth;              // open conditional blocks
+    ConstUndo *log;
+    int log_top;
+    int log_cap;
+    FoldFrame *fold;        // work stacks, so deep trees do not recurse
+    int fold_cap;
+    OptFrame *frames;
+    int frame_cap;
+    int folded;             // binary operations replaced by their value
+    int propagated;         // variable reads replaced by a known value
+} Optimizer;
+
+// Function declarations
+void init_optimizer(Optimizer *o);
+void reset_optimizer(Optimizer *o);
+void optimize_program(Optimizer *o, AST *t, NodeId node);
+void cleanup_optimizer(Optimizer *o);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,162 @@
+// Output sinks for generated assembly
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include "output.h"
+
+static void file_sink_write(void *user, const char *data, size_t len) {
+    fwrite(data, 1, len, (FILE*)user);
+}
+
+// sink writing through a stdio stream
+void init_file_sink(OutputSink *sink, FILE *f) {
+    sink->write = file_sink_write;
+    sink->user = f;
+}
+
+static void string_sink_write(void *user, const char *data, size_t len) {
+    StringBuffer *buf = (StringBuffer*)user;
+    if (buf->cap - buf->len < len) {
+        size_t cap = buf->cap ? buf->cap : 4096;
+        while (cap - buf->len < len) {
+            cap *= 2;
+        }
+        char *grown = (char*)realloc(buf->data, cap);
+        if (!grown) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        buf->data = grown;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+// sink appending to a string buffer (the buffer keeps its capacity)
+void init_string_sink(OutputSink *sink, StringBuffer *buf) {
+    sink->write = string_sink_write;
+    sink->user = buf;
+}
+
+// write all of data to fd, retrying short and interrupted writes
+static void write_all(FdBuffer *buf, const char *data, size_t len) {
+    while (len > 0 && !buf->failed) {
+        ssize_t n = write(buf->fd, data, len);
+        if (n < 0) {
+            if (errno != EINTR) {
+                buf->failed = 1;
+            }
+            continue;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void fd_sink_write(void *user, const char *data, size_t len) {
+    FdBuffer *buf = (FdBuffer*)user;
+    if (buf->cap - buf->len < len) {
+        write_all(buf, buf->data, buf->len);
+        buf->len = 0;
+        if (len >= buf->cap) {
+            // too big to be worth copying
+            write_all(buf, data, len);
+            return;
+        }
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+// sink buffering up to OUTPUT_BUFFER_SIZE bytes before writing to fd;
+// flush_fd_buffer must be called once output is complete
+void init_fd_sink(OutputSink *sink, FdBuffer *buf, int fd) {
+    buf->fd = fd;
+    buf->data = (char*)malloc(OUTPUT_BUFFER_SIZE);
+    if (!buf->data) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    buf->len = 0;
+    buf->cap = OUTPUT_BUFFER_SIZE;
+    buf->failed = 0;
+    sink->write = fd_sink_write;
+    sink->user = buf;
+}
+
+// write out buffered bytes; 0 if any write failed
+int flush_fd_buffer(FdBuffer *buf) {
+    write_all(buf, buf->data, buf->len);
+    buf->len = 0;
+    return !buf->failed;
+}
+
+void free_fd_buffer(FdBuffer *buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = 0;
+    buf->cap = 0;
+}
+
+static void null_sink_write(void *user, const char *data, size_t len) {
+    (void)user;
+    (void)data;
+    (void)len;
+}
+
+// sink discarding everything
+void init_null_sink(OutputSink *sink) {
+    sink->write = null_sink_write;
+    sink->user = NULL;
+}
+
+void free_string_buffer(StringBuffer *buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = 0;
+    buf->cap = 0;
+}
+
+void sink_write(OutputSink *sink, const char *data, size_t len) {
+    sink->write(sink->user, data, len);
+}
+
+// formatted write, lines longer than the stack buffer go through the heap
+void sink_vprintf(OutputSink *sink, const char *fmt, va_list ap) {
+    char line[256];
+    va_list again;
+
+    va_copy(again, ap);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    if (n < 0) {
+        va_end(again);
+        return;
+    }
+    if ((size_t)n < sizeof(line)) {
+        sink->write(sink->user, line, (size_t)n);
+        va_end(again);
+        return;
+    }
+
+    char *big = (char*)malloc((size_t)n + 1);
+    if (!big) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    vsnprintf(big, (size_t)n + 1, fmt, again);
+    va_end(again);
+    sink->write(sink->user, big, (size_t)n);
+    free(big);
+}
+
+void sink_printf(OutputSink *sink, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    sink_vprintf(sink, fmt, ap);
+    va_end(ap);
+}
\ No newline at end of file
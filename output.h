@@ -0,0 +1,45 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+// Destination for generated assembly
+typedef struct {
+    void (*write)(void *user, const char *data, size_t len);
+    void *user;
+} OutputSink;
+
+// Writer on a file descriptor that collects output in one large
+// user-space buffer, so big outputs take few write system calls
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+typedef struct {
+    int fd;
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;         // a write to fd returned an error
+} FdBuffer;
+
+// Growable in-memory buffer for API callers
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} StringBuffer;
+
+// Function declarations
+void init_file_sink(OutputSink *sink, FILE *f);
+void init_string_sink(OutputSink *sink, StringBuffer *buf);
+void init_fd_sink(OutputSink *sink, FdBuffer *buf, int fd);
+void init_null_sink(OutputSink *sink);
+int flush_fd_buffer(FdBuffer *buf);
+void free_fd_buffer(FdBuffer *buf);
+void free_string_buffer(StringBuffer *buf);
+void sink_write(OutputSink *sink, const char *data, size_t len);
+void sink_printf(OutputSink *sink, const char *fmt, ...);
+void sink_vprintf(OutputSink *sink, const char *fmt, va_list ap);
+
+#endif
\ No newline at end of file
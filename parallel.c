@@ -0,0 +1,264 @@
+// Parallel code generation across top-level statements
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parallel.h"
+#include "pool.h"
+
+// nodes of top-level statements one task lowers, and tasks per thread in
+// a round; each round is joined before the next, which bounds the text
+// and code held in memory
+#define CHUNK_NODES 16384
+#define CHUNKS_PER_JOB 4
+
+// one lowered statement, enough for the join to redo its peephole pass
+typedef struct {
+    size_t text_end;        // end of its assembly in the chunk's text
+    int ir_end;             // end of its optimized code in the chunk's ir (held code only)
+    int raw_end;            // end of its code before the peephole pass in raw
+    int instructions;       // counted when printed
+    int hits[PEEP_RULE_COUNT];
+    RegState exit;          // peephole register state after it
+} StmtTrace;
+
+// run of top-level statements lowered by one task
+typedef struct {
+    int first;              // statements [first, first + count) of the program
+    int count;
+    int label_base;         // label_num before its first statement in serial order
+    int done;               // statements lowered before an error, count if none
+    CodeGenState cg;        // private state sharing the variable table
+    ErrorHandler err;
+    OutputSink sink;
+    StringBuffer text;      // printed assembly
+    IRBuffer raw;           // code of every statement before the peephole pass
+    StmtTrace *trace;
+    int trace_cap;
+} CodeChunk;
+
+typedef struct {
+    CodeGenState *cg;
+    const AST *t;
+    const NodeId *stmts;
+    CodeChunk *chunks;
+    int hold;               // keep optimized code for the join instead of printing it
+    RegState entry;         // register state every chunk starts from
+} ParallelGen;
+
+static void ir_copy(IRBuffer *dst, const IRInstr *code, int count) {
+    for (int i = 0; i < count; i++) {
+        *ir_append(dst, code[i].op) = code[i];
+    }
+}
+
+static StmtTrace* push_trace(CodeChunk *c, int i) {
+    if (i == c->trace_cap) {
+        c->trace_cap = c->trace_cap ? c->trace_cap * 2 : 256;
+        c->trace = (StmtTrace*)realloc(c->trace, sizeof(StmtTrace) * c->trace_cap);
+        if (!c->trace) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+    }
+    return &c->trace[i];
+}
+
+// set up the chunk's private state from the shared one, keeping its
+// own instruction buffer and work stacks from earlier rounds
+static void start_chunk(ParallelGen *pg, CodeChunk *c) {
+    IRBuffer ir = c->cg.ir;
+    BlockFrame *blocks = c->cg.blocks;
+    int block_cap = c->cg.block_cap;
+    ExprFrame *exprs = c->cg.exprs;
+    int expr_cap = c->cg.expr_cap;
+    int *expr_need = c->cg.expr_need;
+    int need_cap = c->cg.need_cap;
+
+    c->cg = *pg->cg;
+    c->cg.ir = ir;
+    c->cg.ir.count = 0;
+    c->cg.ir_optimized = 0;
+    c->cg.blocks = blocks;
+    c->cg.block_cap = block_cap;
+    c->cg.exprs = exprs;
+    c->cg.expr_cap = expr_cap;
+    c->cg.expr_need = expr_need;
+    c->cg.need_cap = need_cap;
+    c->cg.label_num = c->label_base;
+    init_peephole(&c->cg.peep);
+    c->cg.instructions = 0;
+    c->cg.var_lookups = 0;
+    c->cg.var_probes = 0;
+    c->cg.image = NULL;
+    c->cg.hold_code = pg->hold;
+    init_string_sink(&c->sink, &c->text);
+    c->text.len = 0;
+    c->cg.out = &c->sink;
+    init_error_handler(&c->err);
+    c->cg.err = &c->err;
+    c->raw.count = 0;
+    c->done = 0;
+}
+
+// pool task: lower, optimize and print one chunk; an error stops the
+// chunk and is reported by the join once earlier chunks are out
+static void lower_chunk(void *arg, int task, int worker) {
+    ParallelGen *pg = (ParallelGen*)arg;
+    CodeChunk *c = &pg->chunks[task];
+    (void)worker;
+    start_chunk(pg, c);
+    if (setjmp(c->err.env) != 0) {
+        c->err.active = 0;
+        return;
+    }
+    c->err.active = 1;
+
+    CodeGenState *w = &c->cg;
+    for (; c->done < c->count; c->done++) {
+        int start = w->ir.count;
+        generate_code(w, pg->t, pg->stmts[c->first + c->done], 1);
+        ir_copy(&c->raw, w->ir.code + start, w->ir.count - start);
+
+        unsigned long long hits[PEEP_RULE_COUNT];
+        memcpy(hits, w->peep.hits, sizeof(hits));
+        size_t instructions = w->instructions;
+        flush_code(w);
+
+        StmtTrace *tr = push_trace(c, c->done);
+        tr->text_end = c->text.len;
+        tr->ir_end = w->ir.count;
+        tr->raw_end = c->raw.count;
+        tr->instructions = (int)(w->instructions - instructions);
+        for (int r = 0; r < PEEP_RULE_COUNT; r++) {
+            tr->hits[r] = (int)(w->peep.hits[r] - hits[r]);
+        }
+        tr->exit = w->peep.state;
+    }
+    c->err.active = 0;
+}
+
+// splice a chunk into cg's output. The peephole pass carries register
+// contents from one statement into the next, so while cg's state differs
+// from what the chunk assumed its statements are optimized again from
+// the saved code; once the states agree the rest of the chunk is exactly
+// what serial generation prints. Returns 0 if the chunk hit an error.
+static int join_chunk(ParallelGen *pg, CodeChunk *c) {
+    CodeGenState *cg = pg->cg;
+    int k = 0;
+    for (; k < c->done; k++) {
+        const RegState *assumed = k ? &c->trace[k - 1].exit : &pg->entry;
+        if (memcmp(&cg->peep.state, assumed, sizeof(RegState)) == 0) {
+            break;
+        }
+        int from = k ? c->trace[k - 1].raw_end : 0;
+        ir_copy(&cg->ir, c->raw.code + from, c->trace[k].raw_end - from);
+        flush_code(cg);
+        // counted again above, drop the task's counts for it
+        cg->instructions -= (size_t)c->trace[k].instructions;
+        for (int r = 0; r < PEEP_RULE_COUNT; r++) {
+            cg->peep.hits[r] -= (unsigned long long)c->trace[k].hits[r];
+        }
+    }
+
+    if (k < c->done) {
+        const StmtTrace *last = &c->trace[c->done - 1];
+        if (pg->hold) {
+            int from = k ? c->trace[k - 1].ir_end : 0;
+            ir_copy(&cg->ir, c->cg.ir.code + from, last->ir_end - from);
+            cg->ir_optimized = cg->ir.count;
+            flush_code(cg);
+        } else {
+            size_t from = k ? c->trace[k - 1].text_end : 0;
+            if (last->text_end > from) {
+                sink_write(cg->out, c->text.data + from, last->text_end - from);
+            }
+        }
+        cg->peep.state = last->exit;
+    }
+
+    cg->instructions += c->cg.instructions;
+    cg->var_lookups += c->cg.var_lookups;
+    cg->var_probes += c->cg.var_probes;
+    if (c->cg.temps > cg->temps) {
+        cg->temps = c->cg.temps;
+    }
+    for (int r = 0; r < PEEP_RULE_COUNT; r++) {
+        cg->peep.hits[r] += c->cg.peep.hits[r];
+    }
+    return c->done == c->count;
+}
+
+static void free_chunk(CodeChunk *c) {
+    free_ir(&c->cg.ir);
+    free(c->cg.blocks);
+    free(c->cg.exprs);
+    free(c->cg.expr_need);
+    free_ir(&c->raw);
+    free_string_buffer(&c->text);
+    free(c->trace);
+}
+
+// generate the whole program like generate_code does, cg->jobs threads
+// lowering its top-level statements
+void generate_parallel(CodeGenState *cg, const AST *t, NodeId program) {
+    int max_chunks = cg->jobs * CHUNKS_PER_JOB;
+    ParallelGen pg;
+    pg.cg = cg;
+    pg.t = t;
+    pg.stmts = AST_STMTS(t, program);
+    pg.chunks = (CodeChunk*)calloc(max_chunks, sizeof(CodeChunk));
+    if (!pg.chunks) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    // machine code and slot packing need the instructions in order
+    pg.hold = cg->pack_slots || cg->image != NULL;
+    Peephole fresh;
+    init_peephole(&fresh);
+    pg.entry = fresh.state;
+
+    gen_program_start(cg);
+    int total = AST_COUNT(t, program);
+    int label_num = cg->label_num;
+    int ok = 1;
+    char msg[sizeof(cg->err->msg)];
+    for (int s = 0; s < total && ok; ) {
+        // statements are stored one after another, so a chunk is a node
+        // range and its labels are two per if statement in it
+        int n = 0;
+        for (; n < max_chunks && s < total; n++) {
+            CodeChunk *c = &pg.chunks[n];
+            NodeId start = ast_subtree_start(t, pg.stmts[s]);
+            c->first = s;
+            c->label_base = label_num;
+            do {
+                s++;
+            } while (s < total && pg.stmts[s - 1] - start + 1 < CHUNK_NODES);
+            c->count = s - c->first;
+            for (NodeId i = start; i <= pg.stmts[s - 1]; i++) {
+                if (t->kind[i] == AST_CONDITIONAL) {
+                    label_num += 2;
+                }
+            }
+        }
+
+        pool_run(cg->jobs, n, lower_chunk, &pg);
+        for (int i = 0; i < n && ok; i++) {
+            ok = join_chunk(&pg, &pg.chunks[i]);
+            if (!ok) {
+                strcpy(msg, pg.chunks[i].err.msg);
+            }
+        }
+    }
+    cg->label_num = label_num;
+
+    for (int i = 0; i < max_chunks; i++) {
+        cg->ir_grows += pg.chunks[i].cg.ir.grows + pg.chunks[i].raw.grows;
+        free_chunk(&pg.chunks[i]);
+    }
+    free(pg.chunks);
+    if (!ok) {
+        raise_error(cg->err, "%s", msg);
+    }
+    gen_program_end(cg);
+}
\ No newline at end of file
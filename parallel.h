@@ -0,0 +1,14 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "codegen.h"
+
+// Parallel code generation: top-level statements are lowered and
+// optimized in chunks on cg->jobs threads, each chunk into its own
+// buffers with its own label range, then joined in source order. The
+// output is byte-identical to generating the statements one by one.
+
+// Function declarations
+void generate_parallel(CodeGenState *cg, const AST *t, NodeId program);
+
+#endif
\ No newline at end of file
@@ -1,351 +1,457 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "lexer.h"
-#include "parser.h"
-
-// global state for parsing
-static FILE *parsing_file = NULL;
-static Token curr_token;
-static int token_available = 0;
-
-// helper for token getNextToken call
-int getNextToken_impl(FILE *f, Token *t) {
-    (void)parsing_file; // suppress unused warning
-    return getNextToken(f, t);
-}
-
-// advance to next token
-void advance_token() {
-    if (parsing_file) {
-        token_available = getNextToken(parsing_file, &curr_token);
-    } else {
-        curr_token.type = TOKEN_EOF;
-        strcpy(curr_token.text, "");
-        token_available = 0;
-    }
-}
-
-// expect specific token type
-void require_token(TokenType expected) {
-    if (!token_available) {
-        advance_token();
-    }
-    if (curr_token.type != expected) {
-        printf("Parse Error: Expected %d, got %d ('%s')\n", 
-               expected, curr_token.type, curr_token.text);
-        exit(1);
-    }
-    token_available = 0;
-}
-
-// create new AST node
-ASTNode* new_ast_node(ASTType type) {
-    ASTNode* n = (ASTNode*)malloc(sizeof(ASTNode));
-    if (!n) {
-        printf("Memory allocation failed\n");
-        exit(1);
-    }
-    n->type = type;
-    memset(&n->data, 0, sizeof(n->data));
-    return n;
-}
-
-// create declaration node
-ASTNode* make_decl_node(char* var_name) {
-    ASTNode* n = new_ast_node(AST_DECLARATION);
-    n->data.declaration.variable_name = (char*)malloc(strlen(var_name) + 1);
-    if (!n->data.declaration.variable_name) {
-        printf("Memory allocation failed\n");
-        exit(1);
-    }
-    strcpy(n->data.declaration.variable_name, var_name);
-    return n;
-}
-
-// create assignment node
-ASTNode* make_assign_node(char* var_name, ASTNode* val) {
-    ASTNode* n = new_ast_node(AST_ASSIGNMENT);
-    n->data.assignment.variable_name = (char*)malloc(strlen(var_name) + 1);
-    if (!n->data.assignment.variable_name) {
-        printf("Memory allocation failed\n");
-        exit(1);
-    }
-    strcpy(n->data.assignment.variable_name, var_name);
-    n->data.assignment.value = val;
-    return n;
-}
-
-// create binary operation node
-ASTNode* make_binop_node(BinaryOperator op, ASTNode* left, ASTNode* right) {
-    ASTNode* n = new_ast_node(AST_BINARY_OP);
-    n->data.binary_op.op = op;
-    n->data.binary_op.left = left;
-    n->data.binary_op.right = right;
-    return n;
-}
-
-// create number node
-ASTNode* make_num_node(int val) {
-    ASTNode* n = new_ast_node(AST_NUMBER);
-    n->data.number.value = val;
-    return n;
-}
-
-// create identifier node
-ASTNode* make_id_node(char* name) {
-    ASTNode* n = new_ast_node(AST_IDENTIFIER);
-    n->data.identifier.name = (char*)malloc(strlen(name) + 1);
-    if (!n->data.identifier.name) {
-        printf("Memory allocation failed\n");
-        exit(1);
-    }
-    strcpy(n->data.identifier.name, name);
-    return n;
-}
-
-// create conditional node
-ASTNode* make_if_node(ASTNode* cond, ASTNode* body) {
-    ASTNode* n = new_ast_node(AST_CONDITIONAL);
-    n->data.conditional.condition = cond;
-    n->data.conditional.then_block = body;
-    return n;
-}
-
-// destroy AST node and children
-void destroy_ast(ASTNode* n) {
-    if (!n) return;
-    
-    switch (n->type) {
-        case AST_DECLARATION:
-            free(n->data.declaration.variable_name);
-            break;
-        case AST_ASSIGNMENT:
-            free(n->data.assignment.variable_name);
-            destroy_ast(n->data.assignment.value);
-            break;
-        case AST_BINARY_OP:
-            destroy_ast(n->data.binary_op.left);
-            destroy_ast(n->data.binary_op.right);
-            break;
-        case AST_IDENTIFIER:
-            free(n->data.identifier.name);
-            break;
-        case AST_CONDITIONAL:
-            destroy_ast(n->data.conditional.condition);
-            destroy_ast(n->data.conditional.then_block);
-            break;
-        case AST_PROGRAM:
-            for (int i = 0; i < n->data.program.count; i++) {
-                destroy_ast(n->data.program.statements[i]);
-            }
-            free(n->data.program.statements);
-            break;
-        default:
-            break;
-    }
-    free(n);
-}
-
-// check if current token matches
-int check_token(TokenType t) {
-    if (!token_available) {
-        advance_token();
-    }
-    return curr_token.type == t;
-}
-
-// parse identifier or number
-ASTNode* parse_term() {
-    if (!check_token(TOKEN_NUMBER) && !check_token(TOKEN_IDENTIFIER)) {
-        advance_token();
-    }
-    
-    if (curr_token.type == TOKEN_NUMBER) {
-        int num = atoi(curr_token.text);
-        token_available = 0;
-        return make_num_node(num);
-    }
-    
-    if (curr_token.type == TOKEN_IDENTIFIER) {
-        char* id_name = (char*)malloc(strlen(curr_token.text) + 1);
-        strcpy(id_name, curr_token.text);
-        token_available = 0;
-        ASTNode* node = make_id_node(id_name);
-        free(id_name);
-        return node;
-    }
-    
-    printf("Syntax Error: Expected number or identifier, got '%s'\n", curr_token.text);
-    return NULL;
-}
-
-// parse expression with operators
-ASTNode* parse_expr() {
-    ASTNode* left = parse_term();
-    
-    if (!token_available) {
-        advance_token();
-    }
-    
-    while (curr_token.type == TOKEN_PLUS || curr_token.type == TOKEN_MINUS) {
-        BinaryOperator op;
-        if (curr_token.type == TOKEN_PLUS) {
-            op = OP_ADD;
-        } else {
-            op = OP_SUB;
-        }
-        token_available = 0;
-        advance_token();
-        ASTNode* right = parse_term();
-        left = make_binop_node(op, left, right);
-    }
-    
-    return left;
-}
-
-// parse equality comparison
-ASTNode* parse_comparison() {
-    ASTNode* left = parse_expr();
-    
-    if (!token_available) {
-        advance_token();
-    }
-    
-    if (curr_token.type == TOKEN_EQUAL) {
-        token_available = 0;
-        ASTNode* right = parse_expr();
-        return make_binop_node(OP_EQUAL, left, right);
-    }
-    
-    return left;
-}
-
-// parse variable declaration
-ASTNode* parse_decl_stmt() {
-    require_token(TOKEN_INT);
-    advance_token(); // move to identifier
-    char var_name[100];
-    strcpy(var_name, curr_token.text);
-    require_token(TOKEN_IDENTIFIER);
-    advance_token(); // move past semicolon
-    require_token(TOKEN_SEMICOLON);
-    return make_decl_node(var_name);
-}
-
-// parse assignment statement
-ASTNode* parse_assign_stmt() {
-    char var_name[100];
-    strcpy(var_name, curr_token.text);
-    token_available = 0;
-    require_token(TOKEN_ASSIGN);
-    ASTNode* val = parse_comparison();
-    require_token(TOKEN_SEMICOLON);
-    return make_assign_node(var_name, val);
-}
-
-// parse conditional statement
-ASTNode* parse_if_stmt() {
-    require_token(TOKEN_IF);
-    require_token(TOKEN_LPAREN);
-    advance_token(); // get identifier in condition
-    ASTNode* cond = parse_comparison();
-    require_token(TOKEN_RPAREN);
-    require_token(TOKEN_LBRACE);
-    
-    ASTNode* body = parse_program();
-    
-    require_token(TOKEN_RBRACE);
-    return make_if_node(cond, body);
-}
-
-// parse single statement
-ASTNode* parse_stmt() {
-    if (!check_token(TOKEN_INT) && !check_token(TOKEN_IDENTIFIER) && !check_token(TOKEN_IF)) {
-        advance_token();
-    }
-    
-    if (curr_token.type == TOKEN_INT) {
-        return parse_decl_stmt();
-    } else if (curr_token.type == TOKEN_IDENTIFIER) {
-        return parse_assign_stmt();
-    } else if (curr_token.type == TOKEN_IF) {
-        return parse_if_stmt();
-    } else if (curr_token.type == TOKEN_EOF) {
-        return NULL; // end of file
-    }
-    
-    printf("Parse Error: Unexpected token '%s' (type %d)\n", curr_token.text, curr_token.type);
-    exit(1);
-    return NULL;
-}
-
-// parse entire program
-ASTNode* parse_program() {
-    ASTNode* prog = new_ast_node(AST_PROGRAM);
-    prog->data.program.statements = (ASTNode**)malloc(sizeof(ASTNode*) * 100);
-    prog->data.program.count = 0;
-    
-    advance_token();
-    
-    while (curr_token.type != TOKEN_EOF) {
-        ASTNode* stmt = parse_stmt();
-        if (stmt) {
-            prog->data.program.statements[prog->data.program.count++] = stmt;
-        }
-        if (curr_token.type != TOKEN_EOF) {
-            advance_token();
-        } else {
-            break;
-        }
-    }
-    
-    return prog;
-}
-
-// initialize parser
-void init_parser(FILE* f) {
-    parsing_file = f;
-    token_available = 0;
-}
-
-// print AST for debugging
-void print_ast(ASTNode* n, int indent) {
-    if (!n) return;
-    
-    for (int i = 0; i < indent; i++) {
-        printf("  ");
-    }
-    
-    switch (n->type) {
-        case AST_PROGRAM:
-            printf("PROGRAM (%d statements)\n", n->data.program.count);
-            for (int i = 0; i < n->data.program.count; i++) {
-                print_ast(n->data.program.statements[i], indent + 1);
-            }
-            break;
-        case AST_DECLARATION:
-            printf("DECLARATION: %s\n", n->data.declaration.variable_name);
-            break;
-        case AST_ASSIGNMENT:
-            printf("ASSIGNMENT: %s =\n", n->data.assignment.variable_name);
-            print_ast(n->data.assignment.value, indent + 1);
-            break;
-        case AST_BINARY_OP:
-            printf("BINARY: %d\n", n->data.binary_op.op);
-            print_ast(n->data.binary_op.left, indent + 1);
-            print_ast(n->data.binary_op.right, indent + 1);
-            break;
-        case AST_NUMBER:
-            printf("NUMBER: %d\n", n->data.number.value);
-            break;
-        case AST_IDENTIFIER:
-           printf("IDENTIFIER: %s\n", n->data.identifier.name);
-            break;
-        case AST_CONDITIONAL:
-            printf("IF\n");
-            print_ast(n->data.conditional.condition, indent + 1);
-            print_ast(n->data.conditional.then_block, indent + 1);
-            break;
-    }
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "lexer.h"
+#include "parser.h"
+
+// advance to next token
+void advance_token(Parser* p) {
+    if (p->active && p->lexed) {
+        p->token_available = next_lexed_token(&p->lexed_next, &p->curr_token);
+        p->tokens += p->token_available;
+    } else if (p->active) {
+        p->token_available = getNextToken(&p->lexer, &p->curr_token);
+        p->tokens += p->token_available;
+    } else {
+        p->curr_token.type = TOKEN_EOF;
+        p->curr_token.length = 0;
+        p->token_available = 0;
+    }
+}
+
+// text of current token (not NUL terminated, use with %.*s)
+static const char* curr_text(Parser* p) {
+    return token_text(&p->lexer, &p->curr_token);
+}
+
+// numeric value of current number token; it must fit an int
+static int token_number_value(Parser* p) {
+    const char* s = curr_text(p);
+    unsigned int val = 0;
+    for (size_t i = 0; i < p->curr_token.length; i++) {
+        unsigned int digit = (unsigned int)(s[i] - '0');
+        if (val > ((unsigned int)INT_MAX - digit) / 10) {
+            raise_error(p->err, "Parse Error: Number out of range ('%.*s') at line %d, column %d",
+                        (int)p->curr_token.length, s, p->curr_token.line, p->curr_token.column);
+        }
+        val = val * 10 + digit;
+    }
+    return (int)val;
+}
+
+// expect specific token type
+void require_token(Parser* p, TokenType expected) {
+    if (!p->token_available) {
+        advance_token(p);
+    }
+    if (p->curr_token.type != expected) {
+        raise_error(p->err, "Parse Error: Expected %d, got %d ('%.*s') at line %d, column %d", 
+                    expected, p->curr_token.type, (int)p->curr_token.length, curr_text(p),
+                    p->curr_token.line, p->curr_token.column);
+    }
+    p->token_available = 0;
+}
+
+// append a node to the pool
+static NodeId new_ast_node(Parser* p, ASTType type, int32_t a, int32_t b) {
+    p->nodes++;
+    return ast_add_node(p->ast, type, a, b);
+}
+
+// create declaration node
+NodeId make_decl_node(Parser* p, int sym) {
+    return new_ast_node(p, AST_DECLARATION, sym, 0);
+}
+
+// create assignment node
+NodeId make_assign_node(Parser* p, int sym, NodeId val) {
+    return new_ast_node(p, AST_ASSIGNMENT, sym, val);
+}
+
+// create binary operation node
+NodeId make_binop_node(Parser* p, BinaryOperator op, NodeId left, NodeId right) {
+    NodeId n = new_ast_node(p, AST_BINARY_OP, left, right);
+    p->ast->op[n] = (unsigned char)op;
+    return n;
+}
+
+// create number node
+NodeId make_num_node(Parser* p, int val) {
+    return new_ast_node(p, AST_NUMBER, val, 0);
+}
+
+// create identifier node
+NodeId make_id_node(Parser* p, int sym) {
+    return new_ast_node(p, AST_IDENTIFIER, sym, 0);
+}
+
+// create conditional node
+NodeId make_if_node(Parser* p, NodeId cond, NodeId body) {
+    return new_ast_node(p, AST_CONDITIONAL, cond, body);
+}
+
+// check if current token matches
+int check_token(Parser* p, TokenType t) {
+    if (!p->token_available) {
+        advance_token(p);
+    }
+    return p->curr_token.type == t;
+}
+
+// parse identifier or number
+NodeId parse_term(Parser* p) {
+    if (!check_token(p, TOKEN_NUMBER) && !check_token(p, TOKEN_IDENTIFIER)) {
+        advance_token(p);
+    }
+    
+    if (p->curr_token.type == TOKEN_NUMBER) {
+        int num = token_number_value(p);
+        p->token_available = 0;
+        return make_num_node(p, num);
+    }
+    
+    if (p->curr_token.type == TOKEN_IDENTIFIER) {
+        int sym = p->curr_token.sym;
+        p->token_available = 0;
+        return make_id_node(p, sym);
+    }
+    
+    raise_error(p->err, "Syntax Error: Expected number or identifier, got '%.*s' at line %d, column %d",
+                (int)p->curr_token.length, curr_text(p), p->curr_token.line, p->curr_token.column);
+    return AST_NONE;
+}
+
+// parse expression with operators
+NodeId parse_expr(Parser* p) {
+    NodeId left = parse_term(p);
+    
+    if (!p->token_available) {
+        advance_token(p);
+    }
+    
+    while (p->curr_token.type == TOKEN_PLUS || p->curr_token.type == TOKEN_MINUS) {
+        BinaryOperator op;
+        if (p->curr_token.type == TOKEN_PLUS) {
+            op = OP_ADD;
+        } else {
+            op = OP_SUB;
+        }
+        p->token_available = 0;
+        advance_token(p);
+        NodeId right = parse_term(p);
+        left = make_binop_node(p, op, left, right);
+        
+        // look at the token after the term for a further operator
+        if (!p->token_available) {
+            advance_token(p);
+        }
+    }
+    
+    return left;
+}
+
+// parse equality comparison
+NodeId parse_comparison(Parser* p) {
+    NodeId left = parse_expr(p);
+    
+    if (!p->token_available) {
+        advance_token(p);
+    }
+    
+    if (p->curr_token.type == TOKEN_EQUAL) {
+        p->token_available = 0;
+        NodeId right = parse_expr(p);
+        return make_binop_node(p, OP_EQUAL, left, right);
+    }
+    
+    return left;
+}
+
+// parse variable declaration
+NodeId parse_decl_stmt(Parser* p) {
+    require_token(p, TOKEN_INT);
+    advance_token(p); // move to identifier
+    int sym = p->curr_token.sym;
+    require_token(p, TOKEN_IDENTIFIER);
+    advance_token(p); // move past semicolon
+    require_token(p, TOKEN_SEMICOLON);
+    return make_decl_node(p, sym);
+}
+
+// parse assignment statement
+NodeId parse_assign_stmt(Parser* p) {
+    int sym = p->curr_token.sym;
+    p->token_available = 0;
+    require_token(p, TOKEN_ASSIGN);
+    NodeId val = parse_comparison(p);
+    require_token(p, TOKEN_SEMICOLON);
+    return make_assign_node(p, sym, val);
+}
+
+// parse "if (condition) {" and return the condition; the statement
+// node is made by parse_nested once the block is closed
+NodeId parse_if_head(Parser* p) {
+    require_token(p, TOKEN_IF);
+    require_token(p, TOKEN_LPAREN);
+    advance_token(p); // get identifier in condition
+    NodeId cond = parse_comparison(p);
+    require_token(p, TOKEN_RPAREN);
+    require_token(p, TOKEN_LBRACE);
+    return cond;
+}
+
+// parse single statement; for an if only the head is parsed, it comes
+// back as AST_NONE with the condition in *if_cond
+static NodeId parse_stmt_head(Parser* p, NodeId* if_cond) {
+    *if_cond = AST_NONE;
+    if (!check_token(p, TOKEN_INT) && !check_token(p, TOKEN_IDENTIFIER) && !check_token(p, TOKEN_IF)) {
+        advance_token(p);
+    }
+    
+    if (p->curr_token.type == TOKEN_INT) {
+        return parse_decl_stmt(p);
+    } else if (p->curr_token.type == TOKEN_IDENTIFIER) {
+        return parse_assign_stmt(p);
+    } else if (p->curr_token.type == TOKEN_IF) {
+        *if_cond = parse_if_head(p);
+        return AST_NONE;
+    } else if (p->curr_token.type == TOKEN_EOF) {
+        return AST_NONE; // end of file
+    }
+    
+    raise_error(p->err, "Parse Error: Unexpected token '%.*s' (type %d) at line %d, column %d",
+                (int)p->curr_token.length, curr_text(p), p->curr_token.type,
+                p->curr_token.line, p->curr_token.column);
+    return AST_NONE;
+}
+
+// push statement onto the pending statement stack
+static void push_stmt(Parser* p, NodeId stmt) {
+    if (p->stmt_top == p->stmt_cap) {
+        p->stmt_cap = p->stmt_cap ? p->stmt_cap * 2 : 256;
+        NodeId* grown = (NodeId*)realloc(p->stmt_stack, sizeof(NodeId) * p->stmt_cap);
+        if (!grown) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        p->stmt_stack = grown;
+    }
+    p->stmt_stack[p->stmt_top++] = stmt;
+}
+
+// open a block; cond is the condition of the if that owns it, AST_NONE
+// for the program
+static void open_block(Parser* p, NodeId cond) {
+    if (p->block_top == p->block_cap) {
+        p->block_cap = p->block_cap ? p->block_cap * 2 : 64;
+        OpenBlock* grown = (OpenBlock*)realloc(p->block_stack, sizeof(OpenBlock) * p->block_cap);
+        if (!grown) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        p->block_stack = grown;
+    }
+    p->block_stack[p->block_top].cond = cond;
+    p->block_stack[p->block_top].first = p->stmt_top;
+    p->block_top++;
+    advance_token(p);
+}
+
+// parse statements up to terminator; nested if blocks are kept on
+// block_stack instead of the C stack, so nesting depth is only limited
+// by memory. With outer_cond set, parsing starts inside the block of
+// that if and stops once the block is closed, returning the if.
+static NodeId parse_nested(Parser* p, NodeId outer_cond, TokenType terminator) {
+    int base = p->block_top;
+    open_block(p, outer_cond);
+    
+    for (;;) {
+        TokenType end = p->block_stack[p->block_top - 1].cond != AST_NONE ? TOKEN_RBRACE : terminator;
+        if (p->curr_token.type != end && p->curr_token.type != TOKEN_EOF) {
+            NodeId cond;
+            NodeId stmt = parse_stmt_head(p, &cond);
+            if (cond != AST_NONE) {
+                open_block(p, cond);
+                continue;
+            }
+            if (stmt != AST_NONE) {
+                push_stmt(p, stmt);
+            }
+            if (p->curr_token.type != TOKEN_EOF) {
+                advance_token(p);
+                continue;
+            }
+        }
+        
+        // close the innermost block; its node follows its statements
+        OpenBlock* top = &p->block_stack[--p->block_top];
+        NodeId cond = top->cond;
+        int count = p->stmt_top - top->first;
+        int start = ast_add_list(p->ast, p->stmt_stack + top->first, count);
+        NodeId block = new_ast_node(p, AST_PROGRAM, start, count);
+        p->stmt_top = top->first;
+        
+        if (cond == AST_NONE) {
+            return block;
+        }
+        require_token(p, TOKEN_RBRACE);
+        NodeId if_node = make_if_node(p, cond, block);
+        if (p->block_top == base) {
+            return if_node;
+        }
+        push_stmt(p, if_node);
+        advance_token(p);
+    }
+}
+
+// parse statements up to terminator (EOF for the program, '}' for blocks)
+NodeId parse_block(Parser* p, TokenType terminator) {
+    return parse_nested(p, AST_NONE, terminator);
+}
+
+// parse single statement, including the whole block of an if
+NodeId parse_stmt(Parser* p) {
+    NodeId cond;
+    NodeId stmt = parse_stmt_head(p, &cond);
+    if (cond != AST_NONE) {
+        return parse_nested(p, cond, TOKEN_RBRACE);
+    }
+    return stmt;
+}
+
+// parse entire program
+NodeId parse_program(Parser* p) {
+    return parse_block(p, TOKEN_EOF);
+}
+
+// parse the next top-level statement, AST_NONE at end of input
+NodeId parse_next_statement(Parser* p) {
+    if (p->curr_token.type == TOKEN_EOF) {
+        return AST_NONE;
+    }
+    if (!p->token_available) {
+        advance_token(p);
+    }
+    return parse_stmt(p);
+}
+
+// initialize parser; all nodes go to the ast pool, names to the interner
+void init_parser(Parser* p, AST* ast, Interner* names, ErrorHandler* err) {
+    memset(p, 0, sizeof(*p));
+    p->ast = ast;
+    p->names = names;
+    p->err = err;
+    p->curr_token.type = TOKEN_EOF;
+}
+
+// start parsing a source buffer (whole or streamed)
+void parser_set_input(Parser* p, SourceBuffer* src) {
+    if (src->streaming) {
+        init_lexer_stream(&p->lexer, src, p->names);
+    } else {
+        init_lexer(&p->lexer, src->data, src->len, p->names);
+    }
+    p->active = 1;
+    p->lexed = 0;
+    p->token_available = 0;
+    p->curr_token.type = TOKEN_UNKNOWN;
+    p->stmt_top = 0;
+    p->block_top = 0;
+    p->tokens = 0;
+    p->nodes = 0;
+}
+
+// read the tokens of the input set by parser_set_input from an array
+// lexed beforehand instead of lexing on demand
+void parser_set_tokens(Parser* p, const TokenArray* tokens) {
+    init_token_cursor(&p->lexed_next, tokens);
+    p->lexed = 1;
+}
+
+// release parser scratch memory
+void cleanup_parser(Parser* p) {
+    free(p->stmt_stack);
+    p->stmt_stack = NULL;
+    p->stmt_top = 0;
+    p->stmt_cap = 0;
+    free(p->block_stack);
+    p->block_stack = NULL;
+    p->block_top = 0;
+    p->block_cap = 0;
+}
+
+// node waiting to be printed by print_ast
+typedef struct {
+    NodeId node;
+    int indent;
+} PrintItem;
+
+static void push_print(PrintItem** items, int* top, int* cap, NodeId n, int indent) {
+    if (*top == *cap) {
+        *cap = *cap ? *cap * 2 : 256;
+        PrintItem* grown = (PrintItem*)realloc(*items, sizeof(PrintItem) * *cap);
+        if (!grown) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        *items = grown;
+    }
+    (*items)[*top].node = n;
+    (*items)[*top].indent = indent;
+    (*top)++;
+}
+
+// print AST for debugging; children are pushed in reverse so they
+// come off the work stack in order
+void print_ast(const Interner* names, const AST* t, NodeId root, int depth) {
+    PrintItem* todo = NULL;
+    int top = 0;
+    int cap = 0;
+    push_print(&todo, &top, &cap, root, depth);
+    
+    while (top > 0) {
+        top--;
+        NodeId n = todo[top].node;
+        int indent = todo[top].indent;
+        if (n == AST_NONE) continue;
+        
+        for (int i = 0; i < indent; i++) {
+            printf("  ");
+        }
+        
+        switch (t->kind[n]) {
+            case AST_PROGRAM:
+                printf("PROGRAM (%d statements)\n", AST_COUNT(t, n));
+                for (int i = AST_COUNT(t, n) - 1; i >= 0; i--) {
+                    push_print(&todo, &top, &cap, AST_STMTS(t, n)[i], indent + 1);
+                }
+                break;
+            case AST_DECLARATION:
+                printf("DECLARATION: %s\n", symbol_name(names, AST_SYM(t, n)));
+                break;
+            case AST_ASSIGNMENT:
+                printf("ASSIGNMENT: %s =\n", symbol_name(names, AST_SYM(t, n)));
+                push_print(&todo, &top, &cap, AST_EXPR(t, n), indent + 1);
+                break;
+            case AST_BINARY_OP:
+                printf("BINARY: %d\n", t->op[n]);
+                push_print(&todo, &top, &cap, AST_RIGHT(t, n), indent + 1);
+                push_print(&todo, &top, &cap, AST_LEFT(t, n), indent + 1);
+                break;
+            case AST_NUMBER:
+                printf("NUMBER: %d\n", AST_INT(t, n));
+                break;
+            case AST_IDENTIFIER:
+               printf("IDENTIFIER: %s\n", symbol_name(names, AST_SYM(t, n)));
+                break;
+            case AST_CONDITIONAL:
+                printf("IF\n");
+                push_print(&todo, &top, &cap, AST_BLOCK(t, n), indent + 1);
+                push_print(&todo, &top, &cap, AST_COND(t, n), indent + 1);
+                break;
+        }
+    }
+    
+    free(todo);
 }
\ No newline at end of file
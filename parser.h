@@ -1,79 +1,53 @@
-#ifndef PARSER_H
-#define PARSER_H
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "lexer.h"
-
-// AST Node Types
-typedef enum {
-    AST_DECLARATION,
-    AST_ASSIGNMENT,
-    AST_BINARY_OP,
-    AST_NUMBER,
-    AST_IDENTIFIER,
-    AST_CONDITIONAL,
-    AST_PROGRAM
-} ASTType;
-
-// Binary operators
-typedef enum {
-    OP_ADD,
-    OP_SUB,
-    OP_EQUAL
-} BinaryOperator;
-
-// AST Node structure
-typedef struct ASTNode {
-    ASTType type;
-    union {
-        struct {
-            char* variable_name;
-        } declaration;
-        struct {
-            char* variable_name;
-            struct ASTNode* value;
-        } assignment;
-        struct {
-            BinaryOperator op;
-            struct ASTNode* left;
-            struct ASTNode* right;
-        } binary_op;
-        struct {
-            int value;
-        } number;
-        struct {
-            char* name;
-        } identifier;
-        struct {
-            struct ASTNode* condition;
-            struct ASTNode* then_block;
-        } conditional;
-        struct {
-            struct ASTNode** statements;
-            int count;
-        } program;
-    } data;
-} ASTNode;
-
-// Function declarations
-void init_parser(FILE* file);
-ASTNode* parse_program();
-ASTNode* parse_statement();
-ASTNode* parse_declaration();
-ASTNode* parse_assignment();
-ASTNode* parse_expression();
-ASTNode* parse_conditional();
-ASTNode* parse_primary();
-ASTNode* create_ast_node(ASTType type);
-ASTNode* create_declaration_node(char* variable_name);
-ASTNode* create_assignment_node(char* variable_name, ASTNode* value);
-ASTNode* create_binary_op_node(BinaryOperator op, ASTNode* left, ASTNode* right);
-ASTNode* create_number_node(int value);
-ASTNode* create_identifier_node(char* name);
-ASTNode* create_conditional_node(ASTNode* condition, ASTNode* then_block);
-void free_ast_node(ASTNode* node);
-void print_ast(ASTNode* node, int depth);
-
-#endif
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lexer.h"
+#include "tokens.h"
+#include "source.h"
+#include "ast.h"
+#include "intern.h"
+#include "error.h"
+
+// if block being parsed: its condition (AST_NONE for the program) and
+// where its statements start on stmt_stack
+typedef struct {
+    NodeId cond;
+    int first;
+} OpenBlock;
+
+// Parser state for one compilation
+typedef struct {
+    Lexer lexer;
+    int active;
+    int lexed;                  // tokens come from lexed_next (parser_set_tokens), not lexer
+    TokenCursor lexed_next;
+    Token curr_token;
+    int token_available;
+    AST* ast;
+    Interner* names;
+    ErrorHandler* err;
+    // pending statements of all open blocks, copied into the pool when a block closes
+    NodeId* stmt_stack;
+    int stmt_top;
+    int stmt_cap;
+    OpenBlock* block_stack;     // blocks open at the current token, innermost last
+    int block_top;
+    int block_cap;
+    size_t tokens;      // tokens read and AST nodes built since parser_set_input
+    size_t nodes;
+} Parser;
+
+// Function declarations
+void init_parser(Parser* p, AST* ast, Interner* names, ErrorHandler* err);
+void parser_set_input(Parser* p, SourceBuffer* src);
+void parser_set_tokens(Parser* p, const TokenArray* tokens);
+void cleanup_parser(Parser* p);
+NodeId parse_program(Parser* p);
+NodeId parse_block(Parser* p, TokenType terminator);
+NodeId parse_next_statement(Parser* p);
+void print_ast(const Interner* names, const AST* t, NodeId node, int depth);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,239 @@
+// Peephole optimizer over the instruction list
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "peephole.h"
+
+// instructions looked at past a register write before assuming it is live
+#define DEAD_WRITE_WINDOW 8
+
+// marks an instruction for removal until the next compaction
+#define IR_DEAD ((IROpcode)-1)
+
+static const char *rule_names[PEEP_RULE_COUNT] = {
+    "redundant load",
+    "redundant store",
+    "dead register write",
+    "jump to next instruction"
+};
+
+static void clear_reg(RegValue *r) {
+    r->has_const = 0;
+    r->value = 0;
+    r->mem = -1;
+}
+
+void init_peephole(Peephole *ph) {
+    memset(ph, 0, sizeof(*ph));
+    reset_peephole_state(ph);
+}
+
+// nothing known about the registers, as at program start
+void reset_peephole_state(Peephole *ph) {
+    clear_reg(&ph->state.a);
+    clear_reg(&ph->state.b);
+}
+
+const char* peephole_rule_name(int rule) {
+    return rule_names[rule];
+}
+
+static int same_value(const RegValue *x, const RegValue *y) {
+    return (x->has_const && y->has_const && x->value == y->value) ||
+           (x->mem >= 0 && x->mem == y->mem);
+}
+
+static RegValue* reg_of(RegState *st, char reg) {
+    return reg == 'A' ? &st->a : &st->b;
+}
+
+// drop instructions marked dead, keeping order
+static int compact(IRBuffer *ir) {
+    int n = 0;
+    for (int i = 0; i < ir->count; i++) {
+        if (ir->code[i].op != IR_DEAD) {
+            ir->code[n++] = ir->code[i];
+        }
+    }
+    int removed = ir->count - n;
+    ir->count = n;
+    return removed;
+}
+
+static void kill(IRInstr *in) {
+    in->op = IR_DEAD;
+}
+
+// forward pass tracking register contents: loads of a value already
+// in the register and stores of a value already in memory go away
+static int remove_redundant(Peephole *ph, IRBuffer *ir, RegState *st) {
+    int hits = 0;
+    for (int i = 0; i < ir->count; i++) {
+        IRInstr *in = &ir->code[i];
+        RegValue *r;
+        switch (in->op) {
+            case IR_LDI:
+                r = reg_of(st, in->reg);
+                if (r->has_const && r->value == in->value) {
+                    kill(in);
+                    ph->hits[PEEP_REDUNDANT_LOAD]++;
+                    hits++;
+                    break;
+                }
+                clear_reg(r);
+                r->has_const = 1;
+                r->value = in->value;
+                break;
+            case IR_LOAD:
+                r = reg_of(st, in->reg);
+                if (r->mem == in->value) {
+                    kill(in);
+                    ph->hits[PEEP_REDUNDANT_LOAD]++;
+                    hits++;
+                    break;
+                }
+                clear_reg(r);
+                r->mem = in->value;
+                break;
+            case IR_STORE:
+                {
+                    r = reg_of(st, in->reg);
+                    if (r->mem == in->value) {
+                        kill(in);
+                        ph->hits[PEEP_REDUNDANT_STORE]++;
+                        hits++;
+                        break;
+                    }
+                    // the other register may have cached the old contents
+                    RegValue *other = reg_of(st, in->reg == 'A' ? 'B' : 'A');
+                    if (other->mem == in->value) {
+                        other->mem = same_value(other, r) ? in->value : -1;
+                    }
+                    r->mem = in->value;
+                }
+                break;
+            case IR_MOV:
+                {
+                    RegValue *dst = reg_of(st, in->reg);
+                    RegValue *src = reg_of(st, in->src);
+                    if (same_value(dst, src)) {
+                        kill(in);
+                        ph->hits[PEEP_REDUNDANT_LOAD]++;
+                        hits++;
+                        break;
+                    }
+                    *dst = *src;
+                }
+                break;
+            case IR_ADD:
+            case IR_SUB:
+                clear_reg(&st->a);
+                break;
+            case IR_LABEL:
+            case IR_JMP:
+                // control can arrive from elsewhere
+                clear_reg(&st->a);
+                clear_reg(&st->b);
+                break;
+            default:
+                break;
+        }
+    }
+    return hits;
+}
+
+static int reads_reg(const IRInstr *in, char reg) {
+    switch (in->op) {
+        case IR_STORE:
+            return in->reg == reg;
+        case IR_MOV:
+            return in->src == reg;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_CMP:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int writes_reg(const IRInstr *in, char reg) {
+    return (in->op == IR_LDI || in->op == IR_LOAD || in->op == IR_MOV) && in->reg == reg;
+}
+
+// a register write followed, within the window, by another write of the
+// same register with no read in between is dead; labels, jumps and the
+// end of the statement count as reads
+static int remove_dead_writes(Peephole *ph, IRBuffer *ir) {
+    int hits = 0;
+    for (int i = 0; i < ir->count; i++) {
+        IRInstr *in = &ir->code[i];
+        if (in->op != IR_LDI && in->op != IR_LOAD && in->op != IR_MOV) {
+            continue;
+        }
+        int seen = 0;
+        for (int j = i + 1; j < ir->count && seen < DEAD_WRITE_WINDOW; j++) {
+            IRInstr *next = &ir->code[j];
+            if (next->op == IR_DEAD || next->op == IR_COMMENT) {
+                continue;
+            }
+            seen++;
+            if (next->op == IR_LABEL || next->op == IR_JMP || next->op == IR_JNZ ||
+                reads_reg(next, in->reg)) {
+                break;
+            }
+            if (writes_reg(next, in->reg)) {
+                kill(in);
+                ph->hits[PEEP_DEAD_WRITE]++;
+                hits++;
+                break;
+            }
+        }
+    }
+    return hits;
+}
+
+// a jump whose target label is among the labels right after it
+static int remove_jumps_to_next(Peephole *ph, IRBuffer *ir) {
+    int hits = 0;
+    for (int i = 0; i < ir->count; i++) {
+        IRInstr *in = &ir->code[i];
+        if (in->op != IR_JMP && in->op != IR_JNZ) {
+            continue;
+        }
+        for (int j = i + 1; j < ir->count; j++) {
+            IRInstr *next = &ir->code[j];
+            if (next->op == IR_DEAD || next->op == IR_COMMENT) {
+                continue;
+            }
+            if (next->op != IR_LABEL) {
+                break;
+            }
+            if (ir_same_label(in, next)) {
+                kill(in);
+                ph->hits[PEEP_JUMP_TO_NEXT]++;
+                hits++;
+                break;
+            }
+        }
+    }
+    return hits;
+}
+
+// rewrite ir in place until no rule applies; the register state at the
+// end becomes the starting state for the next call
+void run_peephole(Peephole *ph, IRBuffer *ir) {
+    RegState st;
+    for (;;) {
+        st = ph->state;
+        int hits = remove_redundant(ph, ir, &st);
+        compact(ir);
+        hits += remove_dead_writes(ph, ir);
+        hits += remove_jumps_to_next(ph, ir);
+        compact(ir);
+        if (hits == 0) {
+            break;
+        }
+    }
+    ph->state = st;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "ir.h"
+
+typedef enum {
+    PEEP_REDUNDANT_LOAD,    // register already holds the value
+    PEEP_REDUNDANT_STORE,   // memory already holds the register
+    PEEP_DEAD_WRITE,        // register overwritten before it is read
+    PEEP_JUMP_TO_NEXT,      // jump to a label that directly follows
+    PEEP_RULE_COUNT
+} PeepholeRule;
+
+// what a register is known to hold
+typedef struct {
+    int has_const;
+    int value;
+    int mem;            // address whose contents it equals, -1 = none
+} RegValue;
+
+typedef struct {
+    RegValue a;
+    RegValue b;
+} RegState;
+
+// Windowed peephole optimizer. Code is optimized one top-level
+// statement at a time; the register state is carried from one
+// statement to the next.
+typedef struct {
+    RegState state;
+    unsigned long long hits[PEEP_RULE_COUNT];
+} Peephole;
+
+// Function declarations
+void init_peephole(Peephole *ph);
+void reset_peephole_state(Peephole *ph);
+void run_peephole(Peephole *ph, IRBuffer *ir);
+const char* peephole_rule_name(int rule);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,121 @@
+// Work-stealing thread pool
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "pool.h"
+
+// remaining tasks [lo, hi) owned by one worker
+typedef struct {
+    pthread_mutex_t lock;
+    int lo;
+    int hi;
+} WorkQueue;
+
+typedef struct {
+    WorkQueue *queues;
+    int jobs;
+    PoolTaskFn fn;
+    void *arg;
+} Pool;
+
+typedef struct {
+    Pool *pool;
+    int id;
+} Worker;
+
+// owner takes from the front of its own slice
+static int take_own(WorkQueue *q) {
+    int task = -1;
+    pthread_mutex_lock(&q->lock);
+    if (q->lo < q->hi) {
+        task = q->lo++;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return task;
+}
+
+// thieves take from the back so they rarely contend with the owner
+static int steal(WorkQueue *q) {
+    int task = -1;
+    pthread_mutex_lock(&q->lock);
+    if (q->lo < q->hi) {
+        task = --q->hi;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return task;
+}
+
+static void* worker_main(void *p) {
+    Worker *w = (Worker*)p;
+    Pool *pool = w->pool;
+
+    for (;;) {
+        int task = take_own(&pool->queues[w->id]);
+        for (int k = 1; task < 0 && k < pool->jobs; k++) {
+            task = steal(&pool->queues[(w->id + k) % pool->jobs]);
+        }
+        // no task is ever added, so all queues empty means done
+        if (task < 0) {
+            break;
+        }
+        pool->fn(pool->arg, task, w->id);
+    }
+    return NULL;
+}
+
+// number of online CPUs
+int pool_default_jobs(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+void pool_run(int jobs, int count, PoolTaskFn fn, void *arg) {
+    if (jobs < 1) {
+        jobs = 1;
+    }
+    if (jobs > count) {
+        jobs = count > 0 ? count : 1;
+    }
+
+    Pool pool;
+    pool.jobs = jobs;
+    pool.fn = fn;
+    pool.arg = arg;
+    pool.queues = (WorkQueue*)malloc(sizeof(WorkQueue) * jobs);
+    Worker *workers = (Worker*)malloc(sizeof(Worker) * jobs);
+    pthread_t *threads = (pthread_t*)malloc(sizeof(pthread_t) * jobs);
+    if (!pool.queues || !workers || !threads) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+
+    // split tasks into contiguous slices
+    for (int i = 0; i < jobs; i++) {
+        pthread_mutex_init(&pool.queues[i].lock, NULL);
+        pool.queues[i].lo = (int)((long long)count * i / jobs);
+        pool.queues[i].hi = (int)((long long)count * (i + 1) / jobs);
+        workers[i].pool = &pool;
+        workers[i].id = i;
+    }
+
+    int started = 1;
+    for (int i = 1; i < jobs; i++) {
+        if (pthread_create(&threads[i], NULL, worker_main, &workers[i]) != 0) {
+            break;  // remaining slices get stolen by the running workers
+        }
+        started++;
+    }
+    worker_main(&workers[0]);
+    for (int i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < jobs; i++) {
+        pthread_mutex_destroy(&pool.queues[i].lock);
+    }
+    free(threads);
+    free(workers);
+    free(pool.queues);
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef POOL_H
+#define POOL_H
+
+// Work-stealing parallel loop: runs fn(arg, task, worker) for every
+// task in [0, count) on `jobs` threads (the caller is worker 0). Each
+// worker owns a contiguous slice of tasks and takes from its front;
+// idle workers steal single tasks from the back of other slices.
+typedef void (*PoolTaskFn)(void *arg, int task, int worker);
+
+// Function declarations
+int pool_default_jobs(void);
+void pool_run(int jobs, int count, PoolTaskFn fn, void *arg);
+
+#endif
\ No newline at end of file
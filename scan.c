@@ -0,0 +1,307 @@
+// Scalar and SSE2/AVX2 kernels for scanning whitespace, comments and
+// identifier or number runs, picked once per lexer by CPU support
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scan.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// scalar kernels, the reference for the vector ones
+
+static int is_space(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static int is_ident(unsigned char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26 || (unsigned char)(c - '0') < 10;
+}
+
+static size_t scalar_skip_space(const char *buf, size_t pos, size_t len, int *lines, size_t *line_start) {
+    while (pos < len && is_space((unsigned char)buf[pos])) {
+        if (buf[pos] == '\n') {
+            (*lines)++;
+            *line_start = pos + 1;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+static size_t scalar_skip_ident(const char *buf, size_t pos, size_t len) {
+    while (pos < len && is_ident((unsigned char)buf[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+static size_t scalar_skip_digits(const char *buf, size_t pos, size_t len) {
+    while (pos < len && (unsigned char)(buf[pos] - '0') < 10) {
+        pos++;
+    }
+    return pos;
+}
+
+static size_t scalar_find_newline(const char *buf, size_t pos, size_t len) {
+    const char *nl = memchr(buf + pos, '\n', len - pos);
+    return nl ? (size_t)(nl - buf) : len;
+}
+
+static const ScanKernels scalar_kernels = {
+    "scalar",
+    scalar_skip_space,
+    scalar_skip_ident,
+    scalar_skip_digits,
+    scalar_find_newline
+};
+
+#ifdef HAVE_X86_KERNELS
+
+// Vector kernels classify a whole block into a bit mask (bit i set when
+// byte i belongs to the run) and stop at the first clear bit. Blocks are
+// only loaded while they lie completely inside buf[0..len); the tail
+// goes through the scalar kernel. Most runs in real sources are a few
+// bytes long, so each kernel checks the byte after pos before loading.
+
+static unsigned int ctz32(unsigned int x) {
+    return (unsigned int)__builtin_ctz(x);
+}
+
+// unsigned (x - lo) <= span per byte, with SSE2 only
+#define SSE_IN_RANGE(x, lo, span) \
+    _mm_cmpeq_epi8(_mm_min_epu8(_mm_sub_epi8((x), _mm_set1_epi8((char)(lo))), \
+                                _mm_set1_epi8((char)(span))), \
+                   _mm_sub_epi8((x), _mm_set1_epi8((char)(lo))))
+
+static unsigned int sse2_space_mask(__m128i v) {
+    __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), SSE_IN_RANGE(v, '\t', 4));
+    return (unsigned int)_mm_movemask_epi8(ws);
+}
+
+static unsigned int sse2_ident_mask(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i id = _mm_or_si128(SSE_IN_RANGE(lower, 'a', 25), SSE_IN_RANGE(v, '0', 9));
+    return (unsigned int)_mm_movemask_epi8(id);
+}
+
+static unsigned int sse2_digit_mask(__m128i v) {
+    return (unsigned int)_mm_movemask_epi8(SSE_IN_RANGE(v, '0', 9));
+}
+
+// count newlines among the first n bytes selected by mask
+static void add_newlines(unsigned int nl, size_t block, int *lines, size_t *line_start) {
+    if (nl) {
+        *lines += __builtin_popcount(nl);
+        *line_start = block + 31 - (unsigned int)__builtin_clz(nl) + 1;
+    }
+}
+
+static size_t sse2_skip_space(const char *buf, size_t pos, size_t len, int *lines, size_t *line_start) {
+    if (pos + 1 >= len || !is_space((unsigned char)buf[pos + 1])) {
+        return scalar_skip_space(buf, pos, len, lines, line_start);
+    }
+    while (pos + 16 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buf + pos));
+        unsigned int run = ~sse2_space_mask(v) & 0xFFFF;
+        unsigned int n = run ? ctz32(run) : 16;
+        unsigned int nl = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        add_newlines(nl & ((1u << n) - 1), pos, lines, line_start);
+        pos += n;
+        if (n < 16) {
+            return pos;
+        }
+    }
+    return scalar_skip_space(buf, pos, len, lines, line_start);
+}
+
+static size_t sse2_skip_ident(const char *buf, size_t pos, size_t len) {
+    if (pos + 1 >= len || !is_ident((unsigned char)buf[pos + 1])) {
+        return scalar_skip_ident(buf, pos, len);
+    }
+    while (pos + 16 <= len) {
+        unsigned int run = ~sse2_ident_mask(_mm_loadu_si128((const __m128i*)(buf + pos))) & 0xFFFF;
+        if (run) {
+            return pos + ctz32(run);
+        }
+        pos += 16;
+    }
+    return scalar_skip_ident(buf, pos, len);
+}
+
+static size_t sse2_skip_digits(const char *buf, size_t pos, size_t len) {
+    if (pos + 1 >= len || (unsigned char)(buf[pos + 1] - '0') >= 10) {
+        return scalar_skip_digits(buf, pos, len);
+    }
+    while (pos + 16 <= len) {
+        unsigned int run = ~sse2_digit_mask(_mm_loadu_si128((const __m128i*)(buf + pos))) & 0xFFFF;
+        if (run) {
+            return pos + ctz32(run);
+        }
+        pos += 16;
+    }
+    return scalar_skip_digits(buf, pos, len);
+}
+
+static size_t sse2_find_newline(const char *buf, size_t pos, size_t len) {
+    __m128i newline = _mm_set1_epi8('\n');
+    while (pos + 16 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buf + pos));
+        unsigned int hit = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (hit) {
+            return pos + ctz32(hit);
+        }
+        pos += 16;
+    }
+    return scalar_find_newline(buf, pos, len);
+}
+
+static const ScanKernels sse2_kernels = {
+    "sse2",
+    sse2_skip_space,
+    sse2_skip_ident,
+    sse2_skip_digits,
+    sse2_find_newline
+};
+
+// AVX2 versions of the same kernels, 32 bytes per block
+
+#define AVX_IN_RANGE(x, lo, span) \
+    _mm256_cmpeq_epi8(_mm256_min_epu8(_mm256_sub_epi8((x), _mm256_set1_epi8((char)(lo))), \
+                                      _mm256_set1_epi8((char)(span))), \
+                      _mm256_sub_epi8((x), _mm256_set1_epi8((char)(lo))))
+
+__attribute__((target("avx2")))
+static size_t avx2_skip_space(const char *buf, size_t pos, size_t len, int *lines, size_t *line_start) {
+    if (pos + 1 >= len || !is_space((unsigned char)buf[pos + 1])) {
+        return scalar_skip_space(buf, pos, len, lines, line_start);
+    }
+    while (pos + 32 <= len) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buf + pos));
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                     AVX_IN_RANGE(v, '\t', 4));
+        unsigned int run = ~(unsigned int)_mm256_movemask_epi8(ws);
+        unsigned int n = run ? ctz32(run) : 32;
+        unsigned int nl = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        add_newlines(n < 32 ? nl & ((1u << n) - 1) : nl, pos, lines, line_start);
+        pos += n;
+        if (n < 32) {
+            return pos;
+        }
+    }
+    return sse2_skip_space(buf, pos, len, lines, line_start);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_skip_ident(const char *buf, size_t pos, size_t len) {
+    if (pos + 1 >= len || !is_ident((unsigned char)buf[pos + 1])) {
+        return scalar_skip_ident(buf, pos, len);
+    }
+    while (pos + 32 <= len) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buf + pos));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i id = _mm256_or_si256(AVX_IN_RANGE(lower, 'a', 25), AVX_IN_RANGE(v, '0', 9));
+        unsigned int run = ~(unsigned int)_mm256_movemask_epi8(id);
+        if (run) {
+            return pos + ctz32(run);
+        }
+        pos += 32;
+    }
+    return sse2_skip_ident(buf, pos, len);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_skip_digits(const char *buf, size_t pos, size_t len) {
+    if (pos + 1 >= len || (unsigned char)(buf[pos + 1] - '0') >= 10) {
+        return scalar_skip_digits(buf, pos, len);
+    }
+    while (pos + 32 <= len) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buf + pos));
+        unsigned int run = ~(unsigned int)_mm256_movemask_epi8(AVX_IN_RANGE(v, '0', 9));
+        if (run) {
+            return pos + ctz32(run);
+        }
+        pos += 32;
+    }
+    return sse2_skip_digits(buf, pos, len);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_find_newline(const char *buf, size_t pos, size_t len) {
+    __m256i newline = _mm256_set1_epi8('\n');
+    while (pos + 32 <= len) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buf + pos));
+        unsigned int hit = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        if (hit) {
+            return pos + ctz32(hit);
+        }
+        pos += 32;
+    }
+    return sse2_find_newline(buf, pos, len);
+}
+
+static const ScanKernels avx2_kernels = {
+    "avx2",
+    avx2_skip_space,
+    avx2_skip_ident,
+    avx2_skip_digits,
+    avx2_find_newline
+};
+
+#endif
+
+// kernels this CPU can run, best last
+static int available(const ScanKernels **out) {
+    int n = 0;
+    out[n++] = &scalar_kernels;
+#ifdef HAVE_X86_KERNELS
+    if (__builtin_cpu_supports("sse2")) {
+        out[n++] = &sse2_kernels;
+        if (__builtin_cpu_supports("avx2")) {
+            out[n++] = &avx2_kernels;
+        }
+    }
+#endif
+    return n;
+}
+
+int scan_kernel_count(void) {
+    const ScanKernels *k[3];
+    return available(k);
+}
+
+const ScanKernels* scan_kernel_at(int i) {
+    const ScanKernels *k[3];
+    return i >= 0 && i < available(k) ? k[i] : NULL;
+}
+
+const ScanKernels* scan_scalar_kernels(void) {
+    return &scalar_kernels;
+}
+
+// named kernel set if this CPU supports it, NULL otherwise
+const ScanKernels* scan_kernels_named(const char *name) {
+    const ScanKernels *k[3];
+    int n = available(k);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(k[i]->name, name) == 0) {
+            return k[i];
+        }
+    }
+    return NULL;
+}
+
+// best kernels for this CPU; SIMPLELANG_SCAN=scalar|sse2|avx2 overrides
+const ScanKernels* scan_kernels(void) {
+    const char *forced = getenv("SIMPLELANG_SCAN");
+    if (forced && *forced) {
+        const ScanKernels *k = scan_kernels_named(forced);
+        if (k) {
+            return k;
+        }
+    }
+    const ScanKernels *k[3];
+    return k[available(k) - 1];
+}
\ No newline at end of file
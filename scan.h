@@ -0,0 +1,28 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+
+// Run-scanning kernels used by the lexer fast path. Every kernel reads
+// only buf[pos..len) and returns the index where the run ends.
+typedef struct {
+    const char *name;
+    // end of the whitespace run at pos; adds the newlines it crosses to
+    // *lines and sets *line_start just past the last of them
+    size_t (*skip_space)(const char *buf, size_t pos, size_t len, int *lines, size_t *line_start);
+    // end of the [A-Za-z0-9] run at pos
+    size_t (*skip_ident)(const char *buf, size_t pos, size_t len);
+    // end of the [0-9] run at pos
+    size_t (*skip_digits)(const char *buf, size_t pos, size_t len);
+    // index of the next '\n' at or after pos, len if none
+    size_t (*find_newline)(const char *buf, size_t pos, size_t len);
+} ScanKernels;
+
+// Function declarations
+const ScanKernels* scan_kernels(void);
+const ScanKernels* scan_kernels_named(const char *name);
+const ScanKernels* scan_scalar_kernels(void);
+int scan_kernel_count(void);
+const ScanKernels* scan_kernel_at(int i);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,418 @@
+// Persistent compile server and thin client over a Unix domain socket
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+
+#define LATENCY_SAMPLES 65536
+#define INTERNER_RESET_SYMBOLS (1 << 20)
+
+// warm compiler contexts shared by all connections
+typedef struct {
+    pthread_mutex_t lock;
+    Compiler **idle;
+    int idle_count;
+    int idle_cap;
+    CompileOptions opts;
+} ContextPool;
+
+// ring buffer of recent compile latencies
+typedef struct {
+    pthread_mutex_t lock;
+    double *ms;
+    size_t count;           // samples held (up to LATENCY_SAMPLES)
+    size_t next;
+    unsigned long long requests;
+    unsigned long long errors;
+} LatencyLog;
+
+typedef struct {
+    ContextPool contexts;
+    LatencyLog latency;
+} Server;
+
+typedef struct {
+    Server *server;
+    int fd;
+} Connection;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int read_full(int fd, void *buf, size_t len) {
+    char *p = (char*)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int write_full(int fd, const void *buf, size_t len) {
+    const char *p = (const char*)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int send_message(int fd, char type, const char *data, size_t len) {
+    unsigned char header[5];
+    header[0] = (unsigned char)type;
+    header[1] = (unsigned char)(len >> 24);
+    header[2] = (unsigned char)(len >> 16);
+    header[3] = (unsigned char)(len >> 8);
+    header[4] = (unsigned char)len;
+    return write_full(fd, header, sizeof(header)) && (len == 0 || write_full(fd, data, len));
+}
+
+// read message header, returns 0 on EOF or error
+static int recv_header(int fd, char *type, size_t *len) {
+    unsigned char header[5];
+    if (!read_full(fd, header, sizeof(header))) {
+        return 0;
+    }
+    *type = (char)header[0];
+    *len = ((size_t)header[1] << 24) | ((size_t)header[2] << 16) |
+           ((size_t)header[3] << 8) | (size_t)header[4];
+    return 1;
+}
+
+// take an idle context or make a new one
+static Compiler* acquire_context(ContextPool *pool) {
+    Compiler *ctx = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle_count > 0) {
+        ctx = pool->idle[--pool->idle_count];
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!ctx) {
+        ctx = (Compiler*)malloc(sizeof(Compiler));
+        if (!ctx) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        compiler_init(ctx);
+        ctx->options = pool->opts;
+    }
+    return ctx;
+}
+
+// return context to the pool, keeping its AST pool and interner warm
+static void release_context(ContextPool *pool, Compiler *ctx) {
+    // a long-lived interner only grows, start over once it gets large
+    if (symbol_count(&ctx->names) > INTERNER_RESET_SYMBOLS) {
+        compiler_free(ctx);
+        compiler_init(ctx);
+        ctx->options = pool->opts;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle_count == pool->idle_cap) {
+        int cap = pool->idle_cap ? pool->idle_cap * 2 : 16;
+        Compiler **grown = (Compiler**)realloc(pool->idle, sizeof(Compiler*) * cap);
+        if (!grown) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        pool->idle = grown;
+        pool->idle_cap = cap;
+    }
+    pool->idle[pool->idle_count++] = ctx;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void record_latency(LatencyLog *log, double ms, int ok) {
+    pthread_mutex_lock(&log->lock);
+    log->ms[log->next] = ms;
+    log->next = (log->next + 1) % LATENCY_SAMPLES;
+    if (log->count < LATENCY_SAMPLES) {
+        log->count++;
+    }
+    log->requests++;
+    if (!ok) {
+        log->errors++;
+    }
+    pthread_mutex_unlock(&log->lock);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of sorted samples
+static double percentile(const double *sorted, size_t n, double pct) {
+    size_t rank = (size_t)(pct / 100.0 * n + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > n) {
+        rank = n;
+    }
+    return sorted[rank - 1];
+}
+
+// latency report over the recent samples
+static void format_stats(LatencyLog *log, StringBuffer *text) {
+    pthread_mutex_lock(&log->lock);
+    size_t n = log->count;
+    unsigned long long requests = log->requests;
+    unsigned long long errors = log->errors;
+    double *sorted = (double*)malloc(sizeof(double) * (n ? n : 1));
+    if (!sorted) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    memcpy(sorted, log->ms, sizeof(double) * n);
+    pthread_mutex_unlock(&log->lock);
+
+    qsort(sorted, n, sizeof(double), compare_double);
+
+    OutputSink out;
+    init_string_sink(&out, text);
+    sink_printf(&out, "Requests: %llu (%llu failed)\n", requests, errors);
+    if (n > 0) {
+        sink_printf(&out, "Latency over last %zu requests (ms):\n", n);
+        sink_printf(&out, "  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+                    percentile(sorted, n, 50), percentile(sorted, n, 90),
+                    percentile(sorted, n, 99), percentile(sorted, n, 99.9),
+                    sorted[n - 1]);
+    }
+    free(sorted);
+}
+
+// serve requests on one connection until the client hangs up
+static void* connection_main(void *arg) {
+    Connection *conn = (Connection*)arg;
+    Server *server = conn->server;
+    int fd = conn->fd;
+    free(conn);
+
+    StringBuffer request = {0};
+    StringBuffer reply = {0};
+    char type;
+    size_t len;
+
+    while (recv_header(fd, &type, &len)) {
+        if (len > MAX_REQUEST_SIZE) {
+            send_message(fd, RESP_ERROR, "Request too large", 17);
+            break;
+        }
+        if (request.cap < len) {
+            char *grown = (char*)realloc(request.data, len);
+            if (!grown) {
+                break;
+            }
+            request.data = grown;
+            request.cap = len;
+        }
+        if (len > 0 && !read_full(fd, request.data, len)) {
+            break;
+        }
+        reply.len = 0;
+
+        int sent;
+        if (type == REQ_COMPILE) {
+            double start = now_ms();
+            Compiler *ctx = acquire_context(&server->contexts);
+            OutputSink out;
+            init_string_sink(&out, &reply);
+            int failed = compile_buffer(ctx, request.data, len, &out);
+            if (failed) {
+                reply.len = 0;
+                sink_printf(&out, "%s", compiler_error(ctx));
+            }
+            release_context(&server->contexts, ctx);
+            record_latency(&server->latency, now_ms() - start, !failed);
+            sent = send_message(fd, failed ? RESP_ERROR : RESP_OK, reply.data, reply.len);
+        } else if (type == REQ_STATS) {
+            format_stats(&server->latency, &reply);
+            sent = send_message(fd, RESP_OK, reply.data, reply.len);
+        } else {
+            sent = send_message(fd, RESP_ERROR, "Unknown request", 15);
+        }
+        if (!sent) {
+            break;
+        }
+    }
+
+    free_string_buffer(&request);
+    free_string_buffer(&reply);
+    close(fd);
+    return NULL;
+}
+
+static int fill_address(struct sockaddr_un *addr, const char *socket_path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr->sun_path)) {
+        printf("Socket path too long: '%s'\n", socket_path);
+        return 0;
+    }
+    strcpy(addr->sun_path, socket_path);
+    return 1;
+}
+
+// accept connections forever, one thread per connection
+int serve(const char *socket_path, const CompileOptions *opts) {
+    struct sockaddr_un addr;
+    if (!fill_address(&addr, socket_path)) {
+        return 1;
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        printf("Could not create socket\n");
+        return 1;
+    }
+    unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 128) != 0) {
+        printf("Could not listen on '%s'\n", socket_path);
+        close(listen_fd);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    Server server;
+    memset(&server, 0, sizeof(server));
+    pthread_mutex_init(&server.contexts.lock, NULL);
+    pthread_mutex_init(&server.latency.lock, NULL);
+    server.contexts.opts = *opts;
+    server.latency.ms = (double*)malloc(sizeof(double) * LATENCY_SAMPLES);
+    if (!server.latency.ms) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+
+    printf("SimpleLang compile server listening on %s\n", socket_path);
+    fflush(stdout);
+
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            printf("accept failed: %s\n", strerror(errno));
+            break;
+        }
+
+        Connection *conn = (Connection*)malloc(sizeof(Connection));
+        pthread_t thread;
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->server = &server;
+        conn->fd = fd;
+        if (pthread_create(&thread, NULL, connection_main, conn) != 0) {
+            close(fd);
+            free(conn);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    close(listen_fd);
+    unlink(socket_path);
+    return 1;
+}
+
+static int connect_to(const char *socket_path) {
+    struct sockaddr_un addr;
+    if (!fill_address(&addr, socket_path)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        printf("Could not connect to compile server at '%s'\n", socket_path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+// send one request, print the reply; returns process exit status
+static int client_request(const char *socket_path, char type, const char *data, size_t len) {
+    int fd = connect_to(socket_path);
+    if (fd < 0) {
+        return 1;
+    }
+
+    char reply_type;
+    size_t reply_len;
+    if (!send_message(fd, type, data, len) || !recv_header(fd, &reply_type, &reply_len)) {
+        printf("Compile server closed the connection\n");
+        close(fd);
+        return 1;
+    }
+
+    char *reply = (char*)malloc(reply_len ? reply_len : 1);
+    if (!reply || !read_full(fd, reply, reply_len)) {
+        printf("Compile server closed the connection\n");
+        free(reply);
+        close(fd);
+        return 1;
+    }
+    fwrite(reply, 1, reply_len, stdout);
+    if (reply_type == RESP_ERROR) {
+        printf("\n");
+    }
+    free(reply);
+    close(fd);
+    return reply_type == RESP_OK ? 0 : 1;
+}
+
+// compile input_path on the server and print the assembly
+int client_compile(const char *socket_path, const char *input_path) {
+    SourceBuffer src;
+    if (!source_open(&src, input_path)) {
+        printf("Could not open file '%s'\n", input_path);
+        return 1;
+    }
+    if (src.len > MAX_REQUEST_SIZE) {
+        printf("Input too large for the compile server\n");
+        source_close(&src);
+        return 1;
+    }
+    int status = client_request(socket_path, REQ_COMPILE, src.data, src.len);
+    source_close(&src);
+    return status;
+}
+
+// print the server's request latency report
+int client_stats(const char *socket_path) {
+    return client_request(socket_path, REQ_STATS, NULL, 0);
+}
\ No newline at end of file
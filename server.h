@@ -0,0 +1,21 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "compiler.h"
+
+// Compile server protocol over a Unix domain socket. Every message is
+// a 1-byte type, a 4-byte big-endian payload length and the payload.
+// A connection may carry any number of requests.
+#define REQ_COMPILE 'C'     // payload: source bytes
+#define REQ_STATS   'S'     // payload: empty
+#define RESP_OK     'O'     // payload: assembly or stats text
+#define RESP_ERROR  'E'     // payload: diagnostic
+
+#define MAX_REQUEST_SIZE (1u << 30)
+
+// Function declarations
+int serve(const char *socket_path, const CompileOptions *opts);
+int client_compile(const char *socket_path, const char *input_path);
+int client_stats(const char *socket_path);
+
+#endif
\ No newline at end of file
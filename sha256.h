@@ -0,0 +1,21 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming SHA-256 (FIPS 180-4)
+typedef struct {
+    uint32_t state[8];
+    uint64_t bit_len;
+    unsigned char block[64];
+    size_t block_len;
+} Sha256;
+
+// Function declarations
+void sha256_init(Sha256 *h);
+void sha256_update(Sha256 *h, const void *data, size_t len);
+void sha256_final(Sha256 *h, unsigned char digest[32]);
+void sha256_hex(const unsigned char digest[32], char hex[65]);
+
+#endif
\ No newline at end of file
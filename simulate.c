@@ -0,0 +1,129 @@
+// Cycle-counting simulator of the 8-bit CPU
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simulate.h"
+
+static const char *op_names[SIM_OP_COUNT] = {
+    "ldi",
+    "mov r s",
+    "mov r M",
+    "mov M r",
+    "add",
+    "sub",
+    "cmp",
+    "jmp",
+    "jnz",
+    "hlt"
+};
+
+const char* sim_op_name(int op) {
+    return op_names[op];
+}
+
+void init_simulator(Simulator *sim, int mem_size) {
+    memset(sim, 0, sizeof(*sim));
+    sim->mem = (unsigned char*)calloc(mem_size > 0 ? mem_size : 1, 1);
+    if (!sim->mem) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    sim->mem_size = mem_size;
+}
+
+void free_simulator(Simulator *sim) {
+    free(sim->mem);
+    sim->mem = NULL;
+}
+
+// operand of width bytes at pc, little-endian
+static long fetch(const MachineImage *img, size_t pc, int width, ErrorHandler *err) {
+    if (pc + width > img->len) {
+        raise_error(err, "Simulator: truncated instruction at %04zx", pc - 1);
+    }
+    long v = 0;
+    for (int i = 0; i < width; i++) {
+        v |= (long)img->code[pc + i] << (8 * i);
+    }
+    return v;
+}
+
+static long data_addr(Simulator *sim, long addr, size_t at, ErrorHandler *err) {
+    if (addr >= sim->mem_size) {
+        raise_error(err, "Simulator: data address %ld out of range at %04zx", addr, at);
+    }
+    return addr;
+}
+
+// run from address 0 until hlt
+void run_simulator(Simulator *sim, const MachineImage *img, ErrorHandler *err) {
+    int ab = img->addr_bytes;
+    size_t pc = 0;
+    for (;;) {
+        if (pc >= img->len) {
+            raise_error(err, "Simulator: ran past the end of the code without hlt");
+        }
+        size_t at = pc;
+        unsigned char op = img->code[pc++];
+        SimOp kind = SIM_HLT;
+        long addr;
+
+        if ((op & 0xC0) == OPC_MOV) {
+            int dst = (op >> 3) & 7;
+            int src = op & 7;
+            if (src == REG_FIELD_M && dst < 2) {
+                addr = data_addr(sim, fetch(img, pc, ab, err), at, err);
+                pc += ab;
+                sim->regs[dst] = sim->mem[addr];
+                sim->cycles += 2 + ab;
+                kind = SIM_LOAD;
+            } else if (dst == REG_FIELD_M && src < 2) {
+                addr = data_addr(sim, fetch(img, pc, ab, err), at, err);
+                pc += ab;
+                sim->mem[addr] = sim->regs[src];
+                sim->cycles += 2 + ab;
+                kind = SIM_STORE;
+            } else if (dst < 2 && src < 2) {
+                sim->regs[dst] = sim->regs[src];
+                sim->cycles += 1;
+                kind = SIM_MOV;
+            } else {
+                raise_error(err, "Simulator: bad register in %02x at %04zx", op, at);
+            }
+        } else if ((op & 0xF8) == OPC_LDI && (op & 7) < 2) {
+            sim->regs[op & 7] = (unsigned char)fetch(img, pc, 1, err);
+            pc += 1;
+            sim->cycles += 2;
+            kind = SIM_LDI;
+        } else if (op == OPC_JMP || op == OPC_JNZ) {
+            addr = fetch(img, pc, 2, err);
+            pc += 2;
+            if (op == OPC_JMP || !sim->zero) {
+                pc = (size_t)addr;
+            }
+            sim->cycles += 3;
+            kind = op == OPC_JMP ? SIM_JMP : SIM_JNZ;
+        } else if (op == OPC_ADD) {
+            sim->regs[0] = (unsigned char)(sim->regs[0] + sim->regs[1]);
+            sim->cycles += 1;
+            kind = SIM_ADD;
+        } else if (op == OPC_SUB) {
+            sim->regs[0] = (unsigned char)(sim->regs[0] - sim->regs[1]);
+            sim->cycles += 1;
+            kind = SIM_SUB;
+        } else if (op == OPC_CMP) {
+            sim->zero = sim->regs[0] == sim->regs[1];
+            sim->cycles += 1;
+            kind = SIM_CMP;
+        } else if (op == OPC_HLT) {
+            sim->cycles += 1;
+            sim->counts[SIM_HLT]++;
+            sim->instructions++;
+            return;
+        } else {
+            raise_error(err, "Simulator: unknown opcode %02x at %04zx", op, at);
+        }
+        sim->counts[kind]++;
+        sim->instructions++;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef SIMULATE_H
+#define SIMULATE_H
+
+#include "binary.h"
+#include "error.h"
+
+// Model of the 8-bit CPU running a machine code image: registers A and
+// B, a zero flag set by cmp, separate code and data memories. An
+// instruction takes one cycle per byte fetched plus one per data memory
+// access, so ldi costs 2, mov A M addr 3 (4 with 2-byte addresses) and
+// add 1.
+typedef enum {
+    SIM_LDI,
+    SIM_MOV,        // mov r s
+    SIM_LOAD,       // mov r M addr
+    SIM_STORE,      // mov M r addr
+    SIM_ADD,
+    SIM_SUB,
+    SIM_CMP,
+    SIM_JMP,
+    SIM_JNZ,
+    SIM_HLT,
+    SIM_OP_COUNT
+} SimOp;
+
+typedef struct {
+    unsigned char *mem;     // data memory, zero at reset
+    int mem_size;
+    unsigned char regs[2];  // A, B
+    int zero;               // last cmp found A == B
+    unsigned long long cycles;
+    unsigned long long instructions;
+    unsigned long long counts[SIM_OP_COUNT];
+} Simulator;
+
+// Function declarations
+void init_simulator(Simulator *sim, int mem_size);
+void run_simulator(Simulator *sim, const MachineImage *img, ErrorHandler *err);
+const char* sim_op_name(int op);
+void free_simulator(Simulator *sim);
+
+#endif
\ No newline at end of file
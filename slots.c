@@ -0,0 +1,245 @@
+// Liveness analysis and data memory slot packing
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "slots.h"
+
+typedef unsigned long long Word;
+
+#define WORD_BITS 64
+
+static void* slots_alloc(size_t size) {
+    void *p = calloc(1, size);
+    if (!p) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    return p;
+}
+
+static int test_bit(const Word *set, int v) {
+    return (set[v / WORD_BITS] >> (v % WORD_BITS)) & 1;
+}
+
+static void set_bit(Word *set, int v) {
+    set[v / WORD_BITS] |= (Word)1 << (v % WORD_BITS);
+}
+
+static void clear_bit(Word *set, int v) {
+    set[v / WORD_BITS] &= ~((Word)1 << (v % WORD_BITS));
+}
+
+// variable index of a data address, -1 if it is not a variable
+static int var_at(int addr, int base, int count) {
+    int v = addr - base;
+    return v >= 0 && v < count ? v : -1;
+}
+
+// record that v interferes with every variable in live; only v's row is
+// written, symmetrize() adds the mirrored edges once at the end
+static void add_edges(Word *graph, int words, int v, const Word *live) {
+    Word *row = graph + (size_t)v * words;
+    for (int w = 0; w < words; w++) {
+        row[w] |= live[w];
+    }
+}
+
+// transpose a 64x64 bit block: bit c of row r moves to bit r of row c
+static void transpose_block(Word *b) {
+    Word mask = 0x00000000ffffffffULL;
+    for (int j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for (int k = 0; k < 64; k = (k + j + 1) & ~j) {
+            Word t = ((b[k] >> j) ^ b[k + j]) & mask;
+            b[k] ^= t << j;
+            b[k + j] ^= t;
+        }
+    }
+}
+
+// graph |= transpose(graph), 64x64 blocks at a time; rows is a
+// multiple of 64
+static void symmetrize(Word *graph, int words) {
+    Word a[WORD_BITS], b[WORD_BITS];
+    for (int bi = 0; bi < words; bi++) {
+        for (int bj = bi; bj < words; bj++) {
+            for (int r = 0; r < WORD_BITS; r++) {
+                a[r] = graph[(size_t)(bi * WORD_BITS + r) * words + bj];
+                b[r] = graph[(size_t)(bj * WORD_BITS + r) * words + bi];
+            }
+            transpose_block(a);
+            transpose_block(b);
+            for (int r = 0; r < WORD_BITS; r++) {
+                graph[(size_t)(bj * WORD_BITS + r) * words + bi] |= a[r];
+                graph[(size_t)(bi * WORD_BITS + r) * words + bj] |= b[r];
+            }
+        }
+    }
+}
+
+// live-in set storage for labels, recycled once a label's last jump
+// has read it so only the sets of open jumps are held
+static Word* take_set(Word ***free_sets, int *free_count, int words) {
+    if (*free_count > 0) {
+        return (*free_sets)[--*free_count];
+    }
+    return (Word*)slots_alloc(sizeof(Word) * words);
+}
+
+// Variables count live from a store to their last load. Since every
+// jump goes forward, one backward pass computes liveness: a label's
+// live-in set is saved when the pass reaches it and read back at the
+// jumps that target it. A store interferes with every variable live
+// after it; variables are then colored greedily in declaration order.
+// The interference graph is a bit matrix, so above SLOTS_MAX_VARS
+// variables nothing is packed. Variable i at base + i is moved to
+// addr_of[i]; returns the number of slots used.
+int pack_data_slots(const IRBuffer *ir, int base, int count, int *addr_of) {
+    if (count == 0) {
+        return 0;
+    }
+    if (count > SLOTS_MAX_VARS) {
+        for (int v = 0; v < count; v++) {
+            addr_of[v] = base + v;
+        }
+        return count;
+    }
+    int words = (count + WORD_BITS - 1) / WORD_BITS;
+    Word *live = (Word*)slots_alloc(sizeof(Word) * words);
+    // one row per bit of a row, so symmetrize works on whole blocks
+    Word *graph = (Word*)slots_alloc(sizeof(Word) * words * (size_t)words * WORD_BITS);
+    char *used = (char*)slots_alloc(count);
+
+    // live-in set per label number (label numbers are dense) and the
+    // jumps to it the backward pass has yet to meet
+    int max_label = -1;
+    for (int i = 0; i < ir->count; i++) {
+        if (ir->code[i].op == IR_LABEL && ir->code[i].value > max_label) {
+            max_label = ir->code[i].value;
+        }
+    }
+    int labels = max_label + 1 > 0 ? max_label + 1 : 1;
+    Word **label_live = (Word**)slots_alloc(sizeof(Word*) * labels);
+    int *jumps = (int*)slots_alloc(sizeof(int) * labels);
+    Word **free_sets = (Word**)slots_alloc(sizeof(Word*) * labels);
+    int free_count = 0;
+    for (int i = 0; i < ir->count; i++) {
+        const IRInstr *in = &ir->code[i];
+        if ((in->op == IR_JMP || in->op == IR_JNZ) && in->value <= max_label) {
+            jumps[in->value]++;
+        }
+    }
+
+    for (int i = ir->count - 1; i >= 0; i--) {
+        const IRInstr *in = &ir->code[i];
+        int v;
+        switch (in->op) {
+            case IR_LABEL:
+                if (jumps[in->value] > 0) {
+                    if (!label_live[in->value]) {
+                        label_live[in->value] = take_set(&free_sets, &free_count, words);
+                    }
+                    memcpy(label_live[in->value], live, sizeof(Word) * words);
+                }
+                break;
+            case IR_JMP:
+            case IR_JNZ:
+                {
+                    Word *target = in->value <= max_label ? label_live[in->value] : NULL;
+                    for (int w = 0; w < words; w++) {
+                        // an unknown target keeps everything alive
+                        Word t = target ? target[w] : ~(Word)0;
+                        live[w] = in->op == IR_JMP ? t : live[w] | t;
+                    }
+                    if (!target) {
+                        for (int u = count; u < words * WORD_BITS; u++) {
+                            clear_bit(live, u);
+                        }
+                    } else if (--jumps[in->value] == 0) {
+                        free_sets[free_count++] = target;
+                        label_live[in->value] = NULL;
+                    }
+                }
+                break;
+            case IR_STORE:
+                v = var_at(in->value, base, count);
+                if (v >= 0) {
+                    used[v] = 1;
+                    clear_bit(live, v);
+                    add_edges(graph, words, v, live);
+                }
+                break;
+            case IR_LOAD:
+                v = var_at(in->value, base, count);
+                if (v >= 0) {
+                    used[v] = 1;
+                    set_bit(live, v);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // variables read before any store keep their initial contents apart
+    for (int v = 0; v < count; v++) {
+        if (test_bit(live, v)) {
+            add_edges(graph, words, v, live);
+        }
+    }
+    symmetrize(graph, words);
+
+    // greedy coloring; unused variables share the first slot. taken[c]
+    // is v + 1 when a neighbour of v has color c, so it is never cleared
+    int slots = 0;
+    int *color = (int*)slots_alloc(sizeof(int) * count);
+    int *taken = (int*)slots_alloc(sizeof(int) * (count + 1));
+    for (int v = 0; v < count; v++) {
+        if (!used[v]) {
+            continue;
+        }
+        const Word *row = graph + (size_t)v * words;
+        for (int w = 0; w <= v / WORD_BITS; w++) {
+            Word bits = row[w];
+            if (w == v / WORD_BITS) {
+                bits &= ((Word)1 << (v % WORD_BITS)) - 1;
+            }
+            while (bits) {
+                int u = w * WORD_BITS + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                if (used[u]) {
+                    taken[color[u]] = v + 1;
+                }
+            }
+        }
+        int c = 0;
+        while (taken[c] == v + 1) {
+            c++;
+        }
+        color[v] = c;
+        if (c + 1 > slots) {
+            slots = c + 1;
+        }
+    }
+    if (slots == 0) {
+        slots = 1;
+    }
+    for (int v = 0; v < count; v++) {
+        addr_of[v] = base + (used[v] ? color[v] : 0);
+    }
+
+    for (int l = 0; l <= max_label; l++) {
+        free(label_live[l]);
+    }
+    for (int i = 0; i < free_count; i++) {
+        free(free_sets[i]);
+    }
+    free(label_live);
+    free(free_sets);
+    free(jumps);
+    free(color);
+    free(taken);
+    free(used);
+    free(graph);
+    free(live);
+    return slots;
+}
\ No newline at end of file
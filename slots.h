@@ -0,0 +1,13 @@
+#ifndef SLOTS_H
+#define SLOTS_H
+
+#include "ir.h"
+
+// variables packed at most; the interference graph is a bit matrix of
+// count * count bits, 128 MB at this size
+#define SLOTS_MAX_VARS 32768
+
+// Function declarations
+int pack_data_slots(const IRBuffer *ir, int base, int count, int *addr_of);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+// Source input layer: maps or block-reads the whole file once,
+// or streams it through a fixed window for constant-memory compiles
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "source.h"
+
+#define READ_BLOCK_SIZE (64 * 1024)
+
+// read everything from fd into a growing heap buffer
+static int read_all(int fd, SourceBuffer *src) {
+    size_t cap = READ_BLOCK_SIZE;
+    size_t len = 0;
+    char *buf = (char*)malloc(cap);
+    if (!buf) {
+        return 0;
+    }
+
+    for (;;) {
+        if (cap - len < READ_BLOCK_SIZE) {
+            char *grown = (char*)realloc(buf, cap * 2);
+            if (!grown) {
+                free(buf);
+                return 0;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, buf + len, cap - len);
+        if (n < 0) {
+            free(buf);
+            return 0;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += (size_t)n;
+    }
+
+    src->data = buf;
+    src->len = len;
+    src->mapped = 0;
+    return 1;
+}
+
+// open input path, "-" means standard input
+static int open_input(const char *path) {
+    if (strcmp(path, "-") == 0) {
+        return STDIN_FILENO;
+    }
+    return open(path, O_RDONLY);
+}
+
+static void close_input(int fd) {
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+}
+
+// open source file, returns 1 on success
+int source_open(SourceBuffer *src, const char *path) {
+    memset(src, 0, sizeof(*src));
+    src->eof = 1;
+
+    int fd = open_input(path);
+    if (fd < 0) {
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            posix_madvise(p, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            src->data = (const char*)p;
+            src->len = (size_t)st.st_size;
+            src->mapped = 1;
+            close_input(fd);
+            return 1;
+        }
+    }
+
+    // pipes, empty files or mmap failure: fall back to block reads
+    int ok = read_all(fd, src);
+    close_input(fd);
+    return ok;
+}
+
+// open input as a window of READ_BLOCK_SIZE bytes, filled by source_refill
+int source_open_stream(SourceBuffer *src, const char *path) {
+    memset(src, 0, sizeof(*src));
+
+    int fd = open_input(path);
+    if (fd < 0) {
+        return 0;
+    }
+
+    char *buf = (char*)malloc(READ_BLOCK_SIZE);
+    if (!buf) {
+        close_input(fd);
+        return 0;
+    }
+    src->data = buf;
+    src->cap = READ_BLOCK_SIZE;
+    src->fd = fd;
+    src->streaming = 1;
+    return 1;
+}
+
+// drop data[0..keep_from) and read the next block into the window,
+// growing it only if the kept bytes already fill it; returns bytes read
+size_t source_refill(SourceBuffer *src, size_t keep_from) {
+    if (!src->streaming || src->eof) {
+        return 0;
+    }
+
+    char *buf = (char*)src->data;
+    size_t kept = src->len - keep_from;
+    memmove(buf, buf + keep_from, kept);
+    src->base += keep_from;
+    src->len = kept;
+
+    if (src->len == src->cap) {
+        char *grown = (char*)realloc(buf, src->cap * 2);
+        if (!grown) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+        buf = grown;
+        src->data = buf;
+        src->cap *= 2;
+    }
+
+    ssize_t n;
+    do {
+        n = read(src->fd, buf + src->len, src->cap - src->len);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        src->eof = 1;
+        return 0;
+    }
+    src->len += (size_t)n;
+    return (size_t)n;
+}
+
+// release source buffer
+void source_close(SourceBuffer *src) {
+    if (src->mapped) {
+        munmap((void*)src->data, src->len);
+    } else {
+        free((void*)src->data);
+    }
+    if (src->streaming) {
+        close_input(src->fd);
+    }
+    memset(src, 0, sizeof(*src));
+}
\ No newline at end of file
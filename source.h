@@ -0,0 +1,25 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+
+// Input held in memory: either the whole file (mapped or block-read)
+// or, for streaming compiles, a sliding window refilled from a descriptor
+typedef struct {
+    const char *data;
+    size_t len;
+    int mapped;     // 1 if data points into an mmap'd region
+    int streaming;  // 1 if data is a window over fd
+    int eof;        // no more input beyond data[len]
+    int fd;
+    size_t base;    // absolute input offset of data[0]
+    size_t cap;     // window capacity (streaming only)
+} SourceBuffer;
+
+// Function declarations
+int source_open(SourceBuffer *src, const char *path);
+int source_open_stream(SourceBuffer *src, const char *path);
+size_t source_refill(SourceBuffer *src, size_t keep_from);
+void source_close(SourceBuffer *src);
+
+#endif
\ No newline at end of file
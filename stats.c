@@ -0,0 +1,156 @@
+// Per-phase timing and memory instrumentation
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "stats.h"
+#include "lexer.h"
+#include "intern.h"
+#include "ast.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_MALLINFO2 1
+#endif
+
+static const char *phase_names[PHASE_COUNT] = {
+    "lex",
+    "parse_program",
+    "collect_declarations",
+    "optimize",
+    "generate_code"
+};
+
+const char* stats_phase_name(int phase) {
+    return phase_names[phase];
+}
+
+void init_compile_stats(CompileStats *st, const char *input, size_t bytes, int opt_level) {
+    memset(st, 0, sizeof(*st));
+    st->input = input;
+    st->source_bytes = bytes;
+    st->opt_level = opt_level;
+}
+
+double stats_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// bytes of heap currently allocated, 0 where the C library cannot say
+static size_t heap_in_use(void) {
+#ifdef HAVE_MALLINFO2
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+// add the time since start_ms to phase and sample the heap
+void stats_end_phase(CompileStats *st, CompilePhase phase, double start_ms) {
+    st->phase_ms[phase] += stats_now_ms() - start_ms;
+    size_t heap = heap_in_use();
+    st->phase_heap[phase] = heap;
+    if (heap > st->heap_at_phase_end_max) {
+        st->heap_at_phase_end_max = heap;
+    }
+}
+
+// lexing is interleaved with parsing, so it is timed on its own pass
+// over the source with a scratch interner
+void stats_time_lexing(CompileStats *st, const SourceBuffer *src) {
+    Interner names;
+    Lexer lx;
+    Token t;
+    init_interner(&names);
+    double start = stats_now_ms();
+    init_lexer(&lx, src->data, src->len, &names);
+    while (getNextToken(&lx, &t)) {
+    }
+    stats_end_phase(st, PHASE_LEX, start);
+    free_interner(&names);
+}
+
+void stats_finish(CompileStats *st, double start_ms) {
+    st->total_ms = stats_now_ms() - start_ms;
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        st->peak_rss_kb = ru.ru_maxrss;
+    }
+}
+
+static double per_lookup(unsigned long long probes, unsigned long long lookups) {
+    return lookups ? (double)probes / (double)lookups : 0.0;
+}
+
+static size_t reallocations(const CompileStats *st) {
+    return st->ast_grows + st->ir_grows + st->intern_grows + st->token_grows;
+}
+
+void print_compile_stats(const CompileStats *st, OutputSink *out) {
+    sink_printf(out, "Phase timings (ms) and heap in use after each phase (bytes):\n");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        sink_printf(out, "  %-22s %10.3f %12zu\n", phase_names[p], st->phase_ms[p], st->phase_heap[p]);
+    }
+    sink_printf(out, "  %-22s %10.3f\n", "total", st->total_ms);
+    sink_printf(out, "Tokens: %zu, AST nodes: %zu, instructions: %zu\n",
+                st->tokens, st->ast_nodes, st->instructions);
+    sink_printf(out, "Symbols interned: %d (%llu lookups, %.2f probes per lookup)\n",
+                st->symbols, st->intern_lookups, per_lookup(st->intern_probes, st->intern_lookups));
+    sink_printf(out, "Variable table: %llu lookups, %.2f probes per lookup\n",
+                st->var_lookups, per_lookup(st->var_probes, st->var_lookups));
+    sink_printf(out, "Largest heap in use at a phase end: %zu bytes, peak RSS: %ld KB\n",
+                st->heap_at_phase_end_max, st->peak_rss_kb);
+    sink_printf(out, "AST pool: %zu bytes peak (%d bytes per node)\n",
+                st->ast_peak, (int)AST_NODE_BYTES);
+    sink_printf(out, "Reallocations of the AST pool, instructions, interner and tokens: %zu (%zu, %zu, %zu, %zu)\n",
+                reallocations(st), st->ast_grows, st->ir_grows, st->intern_grows, st->token_grows);
+}
+
+static void write_json_string(OutputSink *out, const char *s) {
+    sink_write(out, "\"", 1);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            sink_printf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            sink_printf(out, "\\u%04x", c);
+        } else {
+            sink_write(out, s, 1);
+        }
+    }
+    sink_write(out, "\"", 1);
+}
+
+void write_stats_json(const CompileStats *st, OutputSink *out) {
+    sink_printf(out, "{\n  \"input\": ");
+    write_json_string(out, st->input);
+    sink_printf(out, ",\n  \"source_bytes\": %zu,\n", st->source_bytes);
+    sink_printf(out, "  \"opt_level\": %d,\n", st->opt_level);
+    sink_printf(out, "  \"cached\": %s,\n", st->cached ? "true" : "false");
+    sink_printf(out, "  \"phases_ms\": {");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        sink_printf(out, "%s\"%s\": %.3f", p ? ", " : "", phase_names[p], st->phase_ms[p]);
+    }
+    sink_printf(out, "},\n  \"phase_heap_bytes\": {");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        sink_printf(out, "%s\"%s\": %zu", p ? ", " : "", phase_names[p], st->phase_heap[p]);
+    }
+    sink_printf(out, "},\n  \"total_ms\": %.3f,\n", st->total_ms);
+    sink_printf(out, "  \"counts\": {\"tokens\": %zu, \"ast_nodes\": %zu, \"instructions\": %zu, "
+                "\"labels\": %d, \"variables\": %d, \"data_slots\": %d, \"symbols\": %d},\n",
+                st->tokens, st->ast_nodes, st->instructions, st->labels, st->variables,
+                st->data_slots, st->symbols);
+    sink_printf(out, "  \"memory\": {\"heap_at_phase_end_max\": %zu, \"peak_rss_kb\": %ld, "
+                "\"ast_peak_bytes\": %zu, \"reallocations\": {\"total\": %zu, \"ast\": %zu, "
+                "\"ir\": %zu, \"interner\": %zu, \"tokens\": %zu}},\n",
+                st->heap_at_phase_end_max, st->peak_rss_kb, st->ast_peak, reallocations(st), st->ast_grows,
+                st->ir_grows, st->intern_grows, st->token_grows);
+    sink_printf(out, "  \"symbol_tables\": {\"intern\": {\"lookups\": %llu, \"probes\": %llu}, "
+                "\"variables\": {\"lookups\": %llu, \"probes\": %llu}}\n}\n",
+                st->intern_lookups, st->intern_probes, st->var_lookups, st->var_probes);
+}
\ No newline at end of file
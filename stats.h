@@ -0,0 +1,49 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include "source.h"
+#include "output.h"
+#include "compiler.h"
+
+// Instrumentation of one compilation (--stats, --stats-json)
+
+typedef struct {
+    const char *input;
+    size_t source_bytes;
+    int opt_level;
+    int cached;                 // output came from the compile cache
+    double phase_ms[PHASE_COUNT];
+    double total_ms;
+    size_t tokens;
+    size_t ast_nodes;
+    size_t instructions;
+    int labels;
+    int variables;
+    int data_slots;
+    int symbols;
+    size_t phase_heap[PHASE_COUNT];     // heap in use at the end of each phase, 0 if unknown
+    size_t heap_at_phase_end_max;   // highest of those; peaks inside a phase are not seen
+    long peak_rss_kb;
+    size_t ast_peak;            // AST node pool bytes
+    size_t ast_grows;           // reallocations of the AST pool, instruction
+    size_t ir_grows;            // buffers, interner and parallel lexing's
+    size_t intern_grows;        // token array
+    size_t token_grows;
+    unsigned long long intern_lookups;
+    unsigned long long intern_probes;
+    unsigned long long var_lookups;
+    unsigned long long var_probes;
+} CompileStats;
+
+// Function declarations
+void init_compile_stats(CompileStats *st, const char *input, size_t bytes, int opt_level);
+const char* stats_phase_name(int phase);
+double stats_now_ms(void);
+void stats_end_phase(CompileStats *st, CompilePhase phase, double start_ms);
+void stats_time_lexing(CompileStats *st, const SourceBuffer *src);
+void stats_finish(CompileStats *st, double start_ms);
+void print_compile_stats(const CompileStats *st, OutputSink *out);
+void write_stats_json(const CompileStats *st, OutputSink *out);
+
+#endif
\ No newline at end of file
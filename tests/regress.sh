@@ -0,0 +1,51 @@
+#!/bin/sh
+# Regression checks for the command line compiler
+# usage: tests/regress.sh [path/to/compiler]
+COMPILER=${1:-./compiler}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+failures=0
+
+fail() {
+    echo "FAIL: $1"
+    failures=$((failures + 1))
+}
+
+# an index written at one -O level must not be reused at another
+cat > "$DIR/p.simplelang" <<'EOF'
+int a;
+int b;
+int c;
+b = a + c;
+c = b - a;
+a = c;
+b = a;
+EOF
+"$COMPILER" -q -O1 "$DIR/p.simplelang" > "$DIR/plain.asm"
+"$COMPILER" -q -O0 --incremental "$DIR/p.simplelang" > /dev/null
+"$COMPILER" -q -O1 --incremental "$DIR/p.simplelang" > "$DIR/incremental.asm"
+cmp -s "$DIR/plain.asm" "$DIR/incremental.asm" ||
+    fail "-O1 --incremental reused fragments indexed at -O0"
+
+# unpacked --incremental output must not be served from the cache to a
+# plain -O2 compile, which packs variables into shared slots
+"$COMPILER" -q -O2 "$DIR/p.simplelang" > "$DIR/packed.asm"
+"$COMPILER" -q -O2 --incremental --cache-dir "$DIR/cache" "$DIR/p.simplelang" > /dev/null
+"$COMPILER" -q -O2 --cache-dir "$DIR/cache" "$DIR/p.simplelang" > "$DIR/cached.asm"
+cmp -s "$DIR/packed.asm" "$DIR/cached.asm" ||
+    fail "-O2 --cache-dir returned output cached by an --incremental compile"
+
+# literals past INT_MAX are rejected instead of overflowing
+printf 'int a;\na = 99999999999999999999;\n' > "$DIR/big.simplelang"
+if "$COMPILER" -q "$DIR/big.simplelang" > "$DIR/big.out" 2>&1 ||
+    ! grep -q "Number out of range" "$DIR/big.out"; then
+    fail "huge literal was not reported as out of range"
+fi
+printf 'int a;\na = 2147483647;\n' > "$DIR/max.simplelang"
+"$COMPILER" -q "$DIR/max.simplelang" > /dev/null 2>&1 ||
+    fail "literal INT_MAX was rejected"
+
+if [ "$failures" -eq 0 ]; then
+    echo "All regression checks passed"
+fi
+[ "$failures" -eq 0 ]
\ No newline at end of file
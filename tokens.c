@@ -0,0 +1,184 @@
+// Parallel lexing of whole source buffers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tokens.h"
+#include "pool.h"
+#include "scan.h"
+
+// smallest piece worth a task, and pieces per thread so idle threads
+// can take over pieces that lex slower than the others
+#define LEX_CHUNK_BYTES (256 * 1024)
+#define CHUNKS_PER_JOB 4
+// offsets within a piece are 32-bit; a piece is at most this plus the
+// rest of the line it ends in, and columns are int already
+#define LEX_MAX_CHUNK_BYTES ((size_t)1 << 30)
+
+typedef struct {
+    const char *buf;
+    TokenArray *out;
+} ParallelLex;
+
+static void* lex_alloc(void *p, size_t size) {
+    void *grown = realloc(p, size ? size : 1);
+    if (!grown) {
+        printf("Memory allocation failed\n");
+        exit(1);
+    }
+    return grown;
+}
+
+void init_token_array(TokenArray *a) {
+    memset(a, 0, sizeof(*a));
+}
+
+void free_token_array(TokenArray *a) {
+    for (int i = 0; i < a->cap; i++) {
+        free(a->pieces[i].tokens);
+        free(a->pieces[i].syms);
+    }
+    free(a->pieces);
+    init_token_array(a);
+}
+
+static void push_token(TokenPiece *p, const Token *t) {
+    if (p->count == p->cap) {
+        // a token every few bytes is typical
+        p->cap = p->cap ? p->cap * 2 : (p->end - p->start) / 4 + 16;
+        p->tokens = (PieceToken*)lex_alloc(p->tokens, sizeof(PieceToken) * p->cap);
+        p->grows++;
+    }
+    PieceToken *pt = &p->tokens[p->count++];
+    pt->offset = (uint32_t)(t->offset - p->start);
+    pt->length = (uint32_t)t->length;
+    pt->line = t->line - 1;
+    pt->column = t->column;
+    pt->sym = t->sym;
+    pt->type = t->type;
+}
+
+// pool task: lex one piece with line numbers counted from its start
+static void lex_piece(void *arg, int task, int worker) {
+    ParallelLex *pl = (ParallelLex*)arg;
+    TokenPiece *p = &pl->out->pieces[task];
+    (void)worker;
+    Lexer lx;
+    Token t;
+    init_interner(&p->names);
+    init_lexer(&lx, pl->buf + p->start, p->end - p->start, &p->names);
+    // offsets stay relative to the whole buffer; the piece starts a line
+    lx.base = p->start;
+    lx.line_start = p->start;
+    p->count = 0;
+    for (;;) {
+        int more = getNextToken(&lx, &t);
+        if (!more && task < pl->out->count - 1) {
+            break;
+        }
+        push_token(p, &t);
+        if (!more) {
+            break;
+        }
+    }
+    p->lines = lx.line - 1;
+}
+
+// lex buf[0..len) into out on jobs threads; identifiers are interned in
+// names in the order a single lexer would have met them
+void lex_parallel(TokenArray *out, const char *buf, size_t len, Interner *names, int jobs) {
+    int n = jobs * CHUNKS_PER_JOB;
+    if ((size_t)n > len / LEX_CHUNK_BYTES) {
+        n = (int)(len / LEX_CHUNK_BYTES);
+    }
+    if ((size_t)n <= len / LEX_MAX_CHUNK_BYTES) {
+        n = (int)(len / LEX_MAX_CHUNK_BYTES) + 1;
+    }
+    if (n > out->cap) {
+        out->pieces = (TokenPiece*)lex_alloc(out->pieces, sizeof(TokenPiece) * n);
+        memset(out->pieces + out->cap, 0, sizeof(TokenPiece) * (n - out->cap));
+        out->cap = n;
+        out->grows++;
+    }
+
+    // cut after the first newline past each even split point; the last
+    // piece is the one reaching the end of buf, so it holds the last line
+    const ScanKernels *k = scan_kernels();
+    size_t start = 0;
+    int pieces = 0;
+    while (pieces < n) {
+        size_t end = len;
+        if (pieces < n - 1) {
+            size_t split = len / n * (size_t)(pieces + 1);
+            end = k->find_newline(buf, split > start ? split : start, len);
+            if (end < len) {
+                end++;
+            }
+        }
+        out->pieces[pieces].start = start;
+        out->pieces[pieces].end = end;
+        pieces++;
+        start = end;
+        if (end == len) {
+            break;
+        }
+    }
+    out->count = pieces;
+
+    ParallelLex pl;
+    pl.buf = buf;
+    pl.out = out;
+    pool_run(jobs, pieces, lex_piece, &pl);
+
+    // piece symbols go to the shared interner piece by piece, each
+    // piece's in its own order of first appearance, which is the order
+    // of first appearance in the whole buffer
+    out->tokens = 0;
+    int lines = 0;
+    for (int i = 0; i < pieces; i++) {
+        TokenPiece *p = &out->pieces[i];
+        p->line_base = lines;
+        lines += p->lines;
+        out->tokens += p->count;
+        int count = symbol_count(&p->names);
+        p->syms = (int*)lex_alloc(p->syms, sizeof(int) * (size_t)count);
+        for (int s = 0; s < count; s++) {
+            const SymbolEntry *e = &p->names.syms[s];
+            p->syms[s] = intern_symbol(names, e->name, e->len);
+        }
+        names->lookups += p->names.lookups;
+        names->probes += p->names.probes;
+        out->grows += p->grows + p->names.grows;
+        p->grows = 0;
+        free_interner(&p->names);
+    }
+    out->tokens--;
+}
+
+void init_token_cursor(TokenCursor *c, const TokenArray *a) {
+    c->array = a;
+    c->piece = 0;
+    c->next = 0;
+}
+
+// next token of the array with shared positions and symbol IDs;
+// returns 0 at TOKEN_EOF, which is returned again on every later call
+int next_lexed_token(TokenCursor *c, Token *t) {
+    const TokenPiece *p = &c->array->pieces[c->piece];
+    while (c->next == p->count) {
+        c->piece++;
+        c->next = 0;
+        p++;
+    }
+    const PieceToken *pt = &p->tokens[c->next];
+    t->type = (TokenType)pt->type;
+    t->offset = p->start + pt->offset;
+    t->length = pt->length;
+    t->line = p->line_base + pt->line + 1;
+    t->column = pt->column;
+    t->sym = pt->sym >= 0 ? p->syms[pt->sym] : -1;
+    if (t->type == TOKEN_EOF) {
+        return 0;
+    }
+    c->next++;
+    return 1;
+}
\ No newline at end of file
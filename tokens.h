@@ -0,0 +1,61 @@
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lexer.h"
+#include "intern.h"
+
+// Parallel lexing of a whole source buffer: tokens never span lines, so
+// the buffer is cut after newlines and the pieces are lexed on `jobs`
+// threads, each with its own interner. The pieces stay in order in one
+// TokenArray that a cursor reads like getNextToken reads the buffer:
+// same tokens, positions and symbol IDs, ending in TOKEN_EOF.
+
+// token as stored by its piece, positions relative to the piece
+typedef struct {
+    uint32_t offset;        // from the start of the piece
+    uint32_t length;
+    int32_t line;           // newlines before it in the piece
+    int32_t column;
+    int32_t sym;            // symbol ID in the piece's interner, -1 if none
+    int32_t type;           // TokenType
+} PieceToken;
+
+// piece of the buffer lexed by one task
+typedef struct {
+    size_t start;           // buf[start, end) ends after a newline or at the end of buf
+    size_t end;
+    PieceToken *tokens;     // TOKEN_EOF only at the end of the last piece
+    size_t count;
+    size_t cap;
+    int lines;              // newlines in the piece
+    int line_base;          // newlines before it
+    Interner names;         // symbols in order of first appearance in the piece
+    size_t grows;           // reallocations of tokens not yet added to the array's
+    int *syms;              // piece symbol ID -> symbol ID in the shared interner
+} TokenPiece;
+
+typedef struct {
+    TokenPiece *pieces;     // kept with their token arrays for the next buffer
+    int count;
+    int cap;
+    size_t tokens;          // TOKEN_EOF not counted
+    size_t grows;           // reallocations of pieces, tokens and piece interners
+} TokenArray;
+
+// read position in a TokenArray
+typedef struct {
+    const TokenArray *array;
+    int piece;
+    size_t next;
+} TokenCursor;
+
+// Function declarations
+void init_token_array(TokenArray *a);
+void free_token_array(TokenArray *a);
+void lex_parallel(TokenArray *out, const char *buf, size_t len, Interner *names, int jobs);
+void init_token_cursor(TokenCursor *c, const TokenArray *a);
+int next_lexed_token(TokenCursor *c, Token *t);
+
+#endif
\ No newline at end of file
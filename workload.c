@@ -0,0 +1,104 @@
+// Synthetic program generator for benchmarks
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "workload.h"
+
+typedef struct {
+    const WorkloadParams *wp;
+    OutputSink *out;
+    unsigned int rng;
+    int remaining;      // statements still to generate
+} Generator;
+
+void default_workload_params(WorkloadParams *wp) {
+    wp->statements = 10000;
+    wp->variables = 100;
+    wp->expr_length = 4;
+    wp->depth = 2;
+    wp->nest = 0;
+    wp->seed = 1;
+}
+
+// xorshift, so a seed gives the same program everywhere
+static unsigned int next_random(Generator *g) {
+    g->rng ^= g->rng << 13;
+    g->rng ^= g->rng >> 17;
+    g->rng ^= g->rng << 5;
+    return g->rng;
+}
+
+static void indent(Generator *g, int level) {
+    for (int i = 0; i < level; i++) {
+        sink_write(g->out, "    ", 4);
+    }
+}
+
+// variable or small constant, mostly variables
+static void gen_term(Generator *g) {
+    if (next_random(g) % 4 == 0) {
+        sink_printf(g->out, "%u", next_random(g) % 100);
+    } else {
+        sink_printf(g->out, "v%u", next_random(g) % (unsigned int)g->wp->variables);
+    }
+}
+
+static void gen_statement(Generator *g, int level) {
+    g->remaining--;
+    indent(g, level);
+
+    // one statement in eight opens a block while nesting allows it
+    if (level < g->wp->depth && g->remaining > 0 && next_random(g) % 8 == 0) {
+        sink_write(g->out, "if (", 4);
+        gen_term(g);
+        sink_write(g->out, " == ", 4);
+        gen_term(g);
+        sink_write(g->out, ") {\n", 4);
+        int body = 1 + (int)(next_random(g) % 4);
+        for (int i = 0; i < body && g->remaining > 0; i++) {
+            gen_statement(g, level + 1);
+        }
+        indent(g, level);
+        sink_write(g->out, "}\n", 2);
+        return;
+    }
+
+    sink_printf(g->out, "v%u = ", next_random(g) % (unsigned int)g->wp->variables);
+    gen_term(g);
+    for (int i = 1; i < g->wp->expr_length; i++) {
+        sink_write(g->out, next_random(g) % 2 ? " + " : " - ", 3);
+        gen_term(g);
+    }
+    sink_write(g->out, ";\n", 2);
+}
+
+// write a valid program of the requested shape to out
+void generate_workload(const WorkloadParams *wp, OutputSink *out) {
+    Generator g;
+    g.wp = wp;
+    g.out = out;
+    g.rng = wp->seed ? wp->seed : 1;
+    g.remaining = wp->statements;
+
+    sink_printf(out, "// synthetic workload: %d statements, %d variables, "
+                "expression length %d, depth %d, seed %u",
+                wp->statements, wp->variables, wp->expr_length, wp->depth, wp->seed);
+    if (wp->nest > 0) {
+        sink_printf(out, ", nest %d", wp->nest);
+    }
+    sink_write(out, "\n", 1);
+    for (int v = 0; v < wp->variables; v++) {
+        sink_printf(out, "int v%d;\n", v);
+    }
+
+    // nested blocks are not indented, that would make the text quadratic
+    for (int i = 0; i < wp->nest; i++) {
+        sink_printf(out, "if (v%d == %u) {\n", i % wp->variables, next_random(&g) % 4);
+    }
+    while (g.remaining > 0) {
+        gen_statement(&g, 0);
+    }
+    for (int i = 0; i < wp->nest; i++) {
+        sink_write(out, "}\n", 2);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stddef.h>
+#include "output.h"
+
+// Shape of a synthetic SimpleLang program
+typedef struct {
+    int statements;     // assignments and ifs, nested ones included
+    int variables;      // all declared up front as v0, v1, ...
+    int expr_length;    // terms on the right of each assignment
+    int depth;          // deepest if nesting
+    int nest;           // if blocks wrapped around the whole program, 0 = none
+    unsigned int seed;
+} WorkloadParams;
+
+// Function declarations
+void default_workload_params(WorkloadParams *wp);
+void generate_workload(const WorkloadParams *wp, OutputSink *out);
+
+#endif
\ No newline at end of file